@@ -3,9 +3,13 @@
 #include "create_actor.h"
 #include "create_network.h"
 #include "random.h"
+#include "time_profiler.h"
+#include <ATen/Parallel.h>
 #include <algorithm>
 #include <iostream>
+#include <iterator>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <torch/cuda.h>
 #include <utility>
@@ -15,14 +19,27 @@ namespace minizero::actor {
 using namespace network;
 using namespace utils;
 
-int ThreadSharedData::getAvailableActorIndex()
+int ThreadSharedData::getAvailableActorIndex(int numa_node)
 {
-    std::lock_guard lock(mutex_);
-    return (actor_index_ < static_cast<int>(actors_.size()) ? actor_index_++ : actors_.size());
+    // only the actors of the cohort in the CPU phase are available, i.e., the actors using its networks, and every numa_nodes_.size()-th of them belongs to the node
+    // the index grows monotonically with the counter, so the counter may run past the last actor without a lock
+    const int index = actor_indices_[numa_node].fetch_add(1, std::memory_order_relaxed) * numa_nodes_.size() + numa_node;
+    const int num_devices = networks_.size() / num_cohorts_;
+    const int actor_index = (index / num_devices) * networks_.size() + cpu_cohort_ * num_devices + index % num_devices;
+    return (actor_index < static_cast<int>(actors_.size()) ? actor_index : actors_.size());
+}
+
+int ThreadSharedData::getActorNUMANode(int actor_id) const
+{
+    // the inverse of the actor order of getAvailableActorIndex
+    const int num_devices = networks_.size() / num_cohorts_;
+    const int index = (actor_id / networks_.size()) * num_devices + actor_id % num_devices;
+    return index % numa_nodes_.size();
 }
 
 void ThreadSharedData::outputGame(const std::shared_ptr<BaseActor>& actor)
 {
+    utils::ScopedStageTimer timer(utils::TimeProfiler::Stage::kGameOutput);
     int game_length = actor->getEnvironment().getActionHistory().size();
     std::pair<int, int> data_range = calculateTrainingDataRange(actor);
 
@@ -45,8 +62,13 @@ void ThreadSharedData::outputGame(const std::shared_ptr<BaseActor>& actor)
         }
     }
 
+    writeGame(oss.str());
+}
+
+void ThreadSharedData::writeGame(const std::string& game_record)
+{
     std::lock_guard lock(mutex_);
-    std::cout << oss.str() << std::endl;
+    std::cout << game_record << std::endl;
 }
 
 std::pair<int, int> ThreadSharedData::calculateTrainingDataRange(const std::shared_ptr<BaseActor>& actor)
@@ -68,48 +90,62 @@ void SlaveThread::initialize()
 
 void SlaveThread::runJob()
 {
+    // with cohorts, both jobs run in a phase: the threads of the GPU job join the CPU job of the other cohort after forwarding
+    if (getSharedData()->do_gpu_job_) { doGPUJob(); }
     if (getSharedData()->do_cpu_job_) {
         while (doCPUJob()) {}
-    } else {
-        doGPUJob();
     }
 }
 
 bool SlaveThread::doCPUJob()
 {
-    size_t actor_id = getSharedData()->getAvailableActorIndex();
+    size_t actor_id = getSharedData()->getAvailableActorIndex(numa_node_);
     if (actor_id >= getSharedData()->actors_.size()) { return false; }
 
     std::shared_ptr<BaseActor>& actor = getSharedData()->actors_[actor_id];
-    int network_id = actor_id % getSharedData()->networks_.size();
-    int network_output_id = actor->getNNEvaluationBatchIndex();
-    if (network_output_id >= 0) {
-        assert(network_output_id < static_cast<int>(getSharedData()->network_outputs_[network_id].size()));
-        actor->afterNNEvaluation(getSharedData()->network_outputs_[network_id][network_output_id]);
+    if (actor->getNNEvaluationBatchIndex() >= 0) {
+        actor->afterNNEvaluation(getNNEvaluationOutput(actor_id));
         if (actor->isSearchDone()) { handleSearchDone(actor_id); }
     }
     actor->beforeNNEvaluation();
+    while (actor->getNNEvaluationBatchIndex() == -1) { // the search is done without network evaluation (terminal leaves or actor_mcts_use_transposition)
+        handleSearchDone(actor_id);
+        actor->beforeNNEvaluation();
+    }
     return true;
 }
 
 void SlaveThread::doGPUJob()
 {
-    if (id_ >= static_cast<int>(getSharedData()->networks_.size())) { return; }
+    const int num_devices = getSharedData()->networks_.size() / getSharedData()->num_cohorts_;
+    if (id_ >= num_devices) { return; }
 
-    std::shared_ptr<Network>& network = getSharedData()->networks_[id_];
+    const int network_id = getSharedData()->gpu_cohort_ * num_devices + id_;
+    std::shared_ptr<Network>& network = getSharedData()->networks_[network_id];
     if (network->getNetworkTypeName() == "alphazero") {
         std::shared_ptr<AlphaZeroNetwork> az_network = std::static_pointer_cast<AlphaZeroNetwork>(network);
-        if (az_network->getBatchSize() > 0) { getSharedData()->network_outputs_[id_] = az_network->forward(); }
+        if (az_network->getBatchSize() > 0) { getSharedData()->network_outputs_[network_id] = az_network->forward(); }
     } else if (network->getNetworkTypeName() == "muzero" || network->getNetworkTypeName() == "muzero_atari") {
         std::shared_ptr<MuZeroNetwork> muzero_network = std::static_pointer_cast<MuZeroNetwork>(network);
         if (muzero_network->getInitialInputBatchSize() > 0) {
-            getSharedData()->network_outputs_[id_] = std::static_pointer_cast<MuZeroNetwork>(network)->initialInference();
+            getSharedData()->network_outputs_[network_id] = std::static_pointer_cast<MuZeroNetwork>(network)->initialInference();
         } else if (muzero_network->getRecurrentInputBatchSize() > 0) {
-            getSharedData()->network_outputs_[id_] = std::static_pointer_cast<MuZeroNetwork>(network)->recurrentInference();
+            getSharedData()->network_outputs_[network_id] = std::static_pointer_cast<MuZeroNetwork>(network)->recurrentInference();
         }
     }
 }
 
+std::shared_ptr<NetworkOutput> SlaveThread::getNNEvaluationOutput(int actor_id)
+{
+    std::shared_ptr<BaseActor>& actor = getSharedData()->actors_[actor_id];
+    if (!getSharedData()->inference_services_.empty()) { return actor->getNNEvaluationOutput(); }
+
+    int network_id = actor_id % getSharedData()->networks_.size();
+    int network_output_id = actor->getNNEvaluationBatchIndex();
+    assert(network_output_id >= 0 && network_output_id < static_cast<int>(getSharedData()->network_outputs_[network_id].size()));
+    return getSharedData()->network_outputs_[network_id][network_output_id];
+}
+
 void SlaveThread::handleSearchDone(int actor_id)
 {
     assert(actor_id >= 0 && actor_id < static_cast<int>(getSharedData()->actors_.size()) && getSharedData()->actors_[actor_id]->isSearchDone());
@@ -126,8 +162,9 @@ void SlaveThread::handleSearchDone(int actor_id)
         int game_length = actor->getEnvironment().getActionHistory().size();
         int sequence_length = config::zero_actor_intermediate_sequence_length;
         if (sequence_length > 0 && game_length >= sequence_length && (game_length - config::learner_n_step_return) % sequence_length == 0) { getSharedData()->outputGame(actor); }
-        actor->resetSearch();
     }
+    // only the searches of self-play are fast searches of playout cap randomization
+    std::static_pointer_cast<ZeroActor>(actor)->resetSelfPlaySearch();
 }
 
 void ActorGroup::run()
@@ -137,10 +174,26 @@ void ActorGroup::run()
         handleCommand();
 
         if (!running_) { continue; }
-        getSharedData()->actor_index_ = 0;
-        for (auto& t : slave_threads_) { t->start(); }
-        for (auto& t : slave_threads_) { t->finish(); }
+        runPhase();
+    }
+}
+
+void ActorGroup::runPhase()
+{
+    for (auto& actor_index : getSharedData()->actor_indices_) { actor_index = 0; }
+    for (auto& t : slave_threads_) { t->start(); }
+    for (auto& t : slave_threads_) { t->finish(); }
+
+    // the leaves are evaluated by the inference services while the actors search, so every phase is a CPU phase
+    if (!getSharedData()->inference_services_.empty()) { return; }
+    if (getSharedData()->num_cohorts_ == 1) {
         getSharedData()->do_cpu_job_ = !getSharedData()->do_cpu_job_;
+        getSharedData()->do_gpu_job_ = !getSharedData()->do_cpu_job_;
+    } else {
+        // the batches of the cohort just searched are forwarded while the next cohort searches
+        getSharedData()->gpu_cohort_ = getSharedData()->cpu_cohort_;
+        getSharedData()->cpu_cohort_ = (getSharedData()->cpu_cohort_ + 1) % getSharedData()->num_cohorts_;
+        getSharedData()->do_cpu_job_ = getSharedData()->do_gpu_job_ = true;
     }
 }
 
@@ -149,9 +202,12 @@ void ActorGroup::initialize()
     int num_threads = std::max(static_cast<int>(torch::cuda::device_count()), config::zero_num_threads);
     createSlaveThreads(num_threads);
     createNeuralNetworks();
+    placeThreads();
     createActors();
     running_ = false;
     getSharedData()->do_cpu_job_ = true;
+    getSharedData()->do_gpu_job_ = false;
+    getSharedData()->cpu_cohort_ = getSharedData()->gpu_cohort_ = 0;
 
     // create one thread to handle I/O
     commands_.clear();
@@ -164,23 +220,114 @@ void ActorGroup::initialize()
 
 void ActorGroup::createNeuralNetworks()
 {
-    int num_networks = std::min(static_cast<int>(torch::cuda::device_count()), config::zero_num_parallel_games);
-    assert(num_networks > 0);
+    // the network of each cohort on each device, or on the CPU if there is no GPU
+    int num_gpus = std::min(static_cast<int>(torch::cuda::device_count()), config::zero_num_parallel_games);
+    int num_devices = std::max(1, num_gpus);
+    int num_cohorts = (config::actor_use_inference_service ? 1 : std::max(1, std::min(config::zero_actor_num_cohorts, config::zero_num_parallel_games / num_devices)));
+    int num_networks = num_devices * num_cohorts;
+    getSharedData()->num_cohorts_ = num_cohorts;
     getSharedData()->networks_.resize(num_networks);
     getSharedData()->network_outputs_.resize(num_networks);
-    for (int gpu_id = 0; gpu_id < num_networks; ++gpu_id) {
-        getSharedData()->networks_[gpu_id] = createNetwork(config::nn_file_name, gpu_id);
+    for (int network_id = 0; network_id < num_networks; ++network_id) {
+        getSharedData()->networks_[network_id] = newNetwork(num_gpus == 0 ? -1 : network_id % num_gpus);
+        if (config::actor_use_inference_service) {
+            getSharedData()->inference_services_.emplace_back(std::make_shared<InferenceService>(getSharedData()->networks_[network_id], config::actor_inference_service_max_batch_size, config::actor_inference_service_max_wait_microseconds));
+        }
+    }
+}
+
+std::shared_ptr<Network> ActorGroup::newNetwork(int gpu_id)
+{
+    return createNetwork(config::nn_file_name, gpu_id);
+}
+
+void ActorGroup::placeThreads()
+{
+    // the slave threads are spread over the NUMA nodes, so that every node has a thread searching its actors
+    assert(config::zero_actor_thread_affinity == "none" || config::zero_actor_thread_affinity == "core" || config::zero_actor_thread_affinity == "node");
+    const std::vector<int> inference_cpus = parseCPUList(config::zero_actor_inference_cpus);
+    std::vector<NUMANode> numa_nodes;
+    if (config::zero_actor_thread_affinity != "none") {
+        for (NUMANode& numa_node : getNUMANodes()) {
+            std::vector<int> cpus;
+            std::set_difference(numa_node.cpus_.begin(), numa_node.cpus_.end(), inference_cpus.begin(), inference_cpus.end(), std::back_inserter(cpus));
+            if (!cpus.empty()) { numa_nodes.push_back({numa_node.id_, cpus}); }
+        }
+        numa_nodes.resize(std::min(numa_nodes.size(), slave_threads_.size()));
+    }
+    if (numa_nodes.empty()) {
+        // the threads are not pinned, except for keeping them off the inference CPUs
+        std::vector<int> cpus;
+        if (!inference_cpus.empty()) {
+            const std::vector<int> allowed_cpus = getThreadAffinity(pthread_self());
+            std::set_difference(allowed_cpus.begin(), allowed_cpus.end(), inference_cpus.begin(), inference_cpus.end(), std::back_inserter(cpus));
+        }
+        numa_nodes.push_back({-1, cpus});
     }
+    getSharedData()->numa_nodes_ = numa_nodes;
+    getSharedData()->actor_indices_ = std::vector<std::atomic<int>>(numa_nodes.size());
+
+    // the threads forwarding the networks run on the inference CPUs, and the torch threads created by them inherit the affinity
+    const int num_devices = getSharedData()->networks_.size() / getSharedData()->num_cohorts_;
+    const bool use_inference_services = !getSharedData()->inference_services_.empty();
+    for (size_t id = 0; id < slave_threads_.size(); ++id) {
+        const NUMANode& numa_node = numa_nodes[id % numa_nodes.size()];
+        std::static_pointer_cast<SlaveThread>(slave_threads_[id])->setNUMANode(id % numa_nodes.size());
+        std::vector<int> cpus;
+        if (!inference_cpus.empty() && !use_inference_services && static_cast<int>(id) < num_devices) {
+            cpus = inference_cpus;
+        } else if (config::zero_actor_thread_affinity == "core") {
+            cpus = {numa_node.cpus_[(id / numa_nodes.size()) % numa_node.cpus_.size()]};
+        } else {
+            cpus = numa_node.cpus_;
+        }
+        if (!cpus.empty() && !setThreadAffinity(slave_thread_handles_[id]->native_handle(), cpus)) { std::cerr << "failed to pin slave thread " << id << " to CPUs " << toCPUListString(cpus) << std::endl; }
+    }
+    if (!inference_cpus.empty()) {
+        for (auto& inference_service : getSharedData()->inference_services_) {
+            if (!inference_service->setThreadAffinity(inference_cpus)) { std::cerr << "failed to pin inference service to CPUs " << toCPUListString(inference_cpus) << std::endl; }
+        }
+        at::set_num_threads(inference_cpus.size());
+    }
+
+    std::ostringstream oss;
+    oss << "[topology] " << slave_threads_.size() << " slave threads";
+    if (config::zero_actor_thread_affinity == "none") {
+        oss << " not pinned";
+    } else {
+        oss << " pinned to " << (config::zero_actor_thread_affinity == "core" ? "cores" : "NUMA nodes") << " of";
+        for (const NUMANode& numa_node : numa_nodes) { oss << " node " << numa_node.id_ << " (CPUs " << toCPUListString(numa_node.cpus_) << ")"; }
+    }
+    oss << ", inference CPUs " << (inference_cpus.empty() ? "not reserved" : toCPUListString(inference_cpus));
+    std::cerr << oss.str() << std::endl;
 }
 
 void ActorGroup::createActors()
 {
     assert(getSharedData()->networks_.size() > 0);
     std::shared_ptr<Network>& network = getSharedData()->networks_[0];
-    uint64_t tree_node_size = static_cast<uint64_t>(config::actor_num_simulation + 1) * network->getActionSize();
-    for (int i = 0; i < config::zero_num_parallel_games; ++i) {
-        getSharedData()->actors_.emplace_back(createActor(tree_node_size, getSharedData()->networks_[i % getSharedData()->networks_.size()]));
+    uint64_t tree_node_size = getTreeNodeSize(network);
+    getSharedData()->evaluation_cache_ = createEvaluationCache(network);
+    getSharedData()->actors_.resize(config::zero_num_parallel_games);
+
+    // the actors of a node are created while the main thread runs on the node, so that their memory is first touched there
+    const std::vector<NUMANode>& numa_nodes = getSharedData()->numa_nodes_;
+    const std::vector<int> main_thread_cpus = getThreadAffinity(pthread_self());
+    for (size_t node = 0; node < numa_nodes.size(); ++node) {
+        std::vector<int> actor_ids;
+        for (int i = 0; i < config::zero_num_parallel_games; ++i) {
+            if (getSharedData()->getActorNUMANode(i) == static_cast<int>(node)) { actor_ids.push_back(i); }
+        }
+        if (actor_ids.empty()) { continue; }
+
+        if (!numa_nodes[node].cpus_.empty()) { setThreadAffinity(pthread_self(), numa_nodes[node].cpus_); }
+        std::shared_ptr<TreeNodePool> tree_node_pool = createTreeNodePool(tree_node_size, network, actor_ids.size(), numa_nodes[node].id_);
+        for (int i : actor_ids) {
+            getSharedData()->actors_[i] = createActor(tree_node_size, getSharedData()->networks_[i % getSharedData()->networks_.size()], tree_node_pool, getSharedData()->evaluation_cache_);
+            if (!getSharedData()->inference_services_.empty()) { getSharedData()->actors_[i]->setInferenceService(getSharedData()->inference_services_[i % getSharedData()->inference_services_.size()]); }
+        }
     }
+    if (!main_thread_cpus.empty()) { setThreadAffinity(pthread_self(), main_thread_cpus); }
 }
 
 void ActorGroup::handleIO()
@@ -189,19 +336,37 @@ void ActorGroup::handleIO()
     const int buffer_size = 10000000;
     command.reserve(buffer_size);
     while (getline(std::cin, command)) {
-        std::lock_guard lock(getSharedData()->mutex_);
+        std::lock_guard lock(command_mutex_);
         commands_.push_back(command);
     }
 }
 
 void ActorGroup::handleCommand()
 {
-    if (commands_.empty() || !getSharedData()->do_cpu_job_) { return; }
+    if (!getSharedData()->do_cpu_job_) { return; }
+    {
+        std::lock_guard lock(command_mutex_);
+        if (commands_.empty()) { return; }
+    }
 
-    std::lock_guard lock(getSharedData()->mutex_);
-    while (!commands_.empty()) {
-        const std::string command = commands_.front();
-        commands_.pop_front();
+    if (getSharedData()->num_cohorts_ > 1) {
+        // forward the pending batch of the last searched cohort first, since the commands may reload or reset the networks
+        getSharedData()->do_cpu_job_ = false;
+        for (auto& actor_index : getSharedData()->actor_indices_) { actor_index = 0; }
+        for (auto& t : slave_threads_) { t->start(); }
+        for (auto& t : slave_threads_) { t->finish(); }
+        getSharedData()->do_cpu_job_ = true;
+    }
+
+    // the commands are done without the lock, the slave threads are idle between the phases
+    std::deque<std::string> commands;
+    {
+        std::lock_guard lock(command_mutex_);
+        commands.swap(commands_);
+    }
+    while (!commands.empty()) {
+        const std::string command = commands.front();
+        commands.pop_front();
 
         // ignore specific command
         std::string command_prefix = ((command.find(" ") == std::string::npos) ? command : command.substr(0, command.find(" ")));
@@ -226,7 +391,12 @@ void ActorGroup::handleCommand(const std::string& command_prefix, const std::str
         std::vector<std::string> args = utils::stringToVector(command);
         assert(args.size() == 2);
         config::nn_file_name = args[1];
-        for (auto& network : getSharedData()->networks_) { network->loadModel(config::nn_file_name, network->getGPUID()); }
+        if (getSharedData()->inference_services_.empty()) {
+            for (auto& network : getSharedData()->networks_) { network->loadModel(config::nn_file_name, network->getGPUID()); }
+        } else {
+            for (auto& inference_service : getSharedData()->inference_services_) { inference_service->loadModel(config::nn_file_name); }
+        }
+        if (getSharedData()->evaluation_cache_) { getSharedData()->evaluation_cache_->clear(); }
     } else if (command_prefix == "update_config") {
         std::cerr << "[command] " << command << std::endl;
         assert(command.find(" ") != std::string::npos);
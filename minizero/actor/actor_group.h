@@ -1,8 +1,12 @@
 #pragma once
 
 #include "base_actor.h"
+#include "cpu_affinity.h"
+#include "evaluation_cache.h"
+#include "inference_service.h"
 #include "network.h"
 #include "paralleler.h"
+#include <atomic>
 #include <deque>
 #include <memory>
 #include <mutex>
@@ -15,32 +19,46 @@ namespace minizero::actor {
 
 class ThreadSharedData : public utils::BaseSharedData {
 public:
-    int getAvailableActorIndex();
+    int getAvailableActorIndex(int numa_node);
+    int getActorNUMANode(int actor_id) const;
     void outputGame(const std::shared_ptr<BaseActor>& actor);
+    virtual void writeGame(const std::string& game_record);
     std::pair<int, int> calculateTrainingDataRange(const std::shared_ptr<BaseActor>& actor);
 
     bool do_cpu_job_;
-    int actor_index_;
-    std::mutex mutex_;
+    bool do_gpu_job_;
+    std::vector<std::atomic<int>> actor_indices_; // the next actor of each NUMA node
+    int num_cohorts_; // the actors of cohort c use the networks [c * num_devices, (c + 1) * num_devices)
+    int cpu_cohort_;  // the cohort whose actors search in the current phase
+    int gpu_cohort_;  // the cohort whose network batches are forwarded in the current phase
+    std::mutex mutex_; // guards the output to std::cout, and the shared data of derived groups such as the pending requests
+    std::vector<utils::NUMANode> numa_nodes_; // the nodes of the slave threads, a single node of unknown ID if the threads are not pinned
     std::vector<std::shared_ptr<BaseActor>> actors_;
     std::vector<std::shared_ptr<network::Network>> networks_;
+    std::vector<std::shared_ptr<network::InferenceService>> inference_services_; // one per network with actor_use_inference_service, otherwise empty
+    std::shared_ptr<EvaluationCache> evaluation_cache_;
     std::vector<std::vector<std::shared_ptr<network::NetworkOutput>>> network_outputs_;
 };
 
 class SlaveThread : public utils::BaseSlaveThread {
 public:
     SlaveThread(int id, std::shared_ptr<utils::BaseSharedData> shared_data)
-        : BaseSlaveThread(id, shared_data) {}
+        : BaseSlaveThread(id, shared_data),
+          numa_node_(0) {}
 
     void initialize() override;
     void runJob() override;
     bool isDone() override { return false; }
+    inline void setNUMANode(int numa_node) { numa_node_ = numa_node; }
 
 protected:
     virtual bool doCPUJob();
     virtual void doGPUJob();
     virtual void handleSearchDone(int actor_id);
+    std::shared_ptr<network::NetworkOutput> getNNEvaluationOutput(int actor_id);
     inline std::shared_ptr<ThreadSharedData> getSharedData() { return std::static_pointer_cast<ThreadSharedData>(shared_data_); }
+
+    int numa_node_; // the index in numa_nodes_ of the actors searched by the thread
 };
 
 class ActorGroup : public utils::BaseParalleler {
@@ -52,7 +70,10 @@ public:
     void summarize() override {}
 
 protected:
+    virtual void runPhase();
     virtual void createNeuralNetworks();
+    virtual std::shared_ptr<network::Network> newNetwork(int gpu_id);
+    virtual void placeThreads();
     virtual void createActors();
     virtual void handleIO();
     virtual void handleCommand();
@@ -63,6 +84,7 @@ protected:
     inline std::shared_ptr<ThreadSharedData> getSharedData() { return std::static_pointer_cast<ThreadSharedData>(shared_data_); }
 
     bool running_;
+    std::mutex command_mutex_;
     std::deque<std::string> commands_;
     std::unordered_set<std::string> ignored_commands_;
 };
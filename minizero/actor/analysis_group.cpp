@@ -0,0 +1,213 @@
+#include "analysis_group.h"
+#include "configuration.h"
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace minizero::actor {
+
+namespace {
+
+std::string toJSONString(const std::string& str)
+{
+    std::string escaped = "\"";
+    for (char c : str) {
+        if (c == '"' || c == '\\') { escaped += '\\'; }
+        escaped += c;
+    }
+    return escaped + "\"";
+}
+
+} // namespace
+
+std::shared_ptr<AnalysisRequest> AnalysisSharedData::popRequest()
+{
+    std::lock_guard lock(mutex_);
+    if (pending_requests_.empty()) { return nullptr; }
+    std::shared_ptr<AnalysisRequest> request = pending_requests_.front();
+    pending_requests_.pop_front();
+    return request;
+}
+
+void AnalysisSharedData::outputResult(const std::string& result)
+{
+    std::lock_guard lock(mutex_);
+    std::cout << result << std::endl;
+}
+
+bool AnalysisSharedData::isAnalyzing()
+{
+    std::lock_guard lock(mutex_);
+    return !pending_requests_.empty() || std::any_of(requests_.begin(), requests_.end(), [](const std::shared_ptr<AnalysisRequest>& request) { return request != nullptr; });
+}
+
+bool AnalysisSlaveThread::doCPUJob()
+{
+    size_t actor_id = getSharedData()->getAvailableActorIndex(numa_node_);
+    if (actor_id >= getSharedData()->actors_.size()) { return false; }
+
+    std::shared_ptr<BaseActor>& actor = getSharedData()->actors_[actor_id];
+    if (actor->getNNEvaluationBatchIndex() >= 0) {
+        actor->afterNNEvaluation(getNNEvaluationOutput(actor_id));
+        if (actor->isSearchDone()) { handleSearchDone(actor_id); }
+    }
+
+    // an idle actor takes the next request, and a search done without network evaluation is followed by the next request at once
+    while (getSharedData()->requests_[actor_id] || startAnalysis(actor_id)) {
+        actor->beforeNNEvaluation();
+        if (actor->getNNEvaluationBatchIndex() >= 0) { break; }
+        handleSearchDone(actor_id);
+    }
+    return true;
+}
+
+void AnalysisSlaveThread::handleSearchDone(int actor_id)
+{
+    assert(actor_id >= 0 && actor_id < static_cast<int>(getSharedData()->actors_.size()) && getSharedData()->requests_[actor_id]);
+
+    std::shared_ptr<BaseActor>& actor = getSharedData()->actors_[actor_id];
+    getSharedData()->outputResult(getAnalysisResult(std::static_pointer_cast<ZeroActor>(actor), *getSharedData()->requests_[actor_id]));
+    getSharedData()->requests_[actor_id] = nullptr;
+    actor->reset(); // release the tree, and no network output is expected by an idle actor
+}
+
+bool AnalysisSlaveThread::startAnalysis(int actor_id)
+{
+    std::shared_ptr<BaseActor>& actor = getSharedData()->actors_[actor_id];
+    for (std::shared_ptr<AnalysisRequest> request = getSharedData()->popRequest(); request; request = getSharedData()->popRequest()) {
+        actor->reset();
+        const std::string error = setUpPosition(actor, *request);
+        if (error.empty()) {
+            actor->resetSearch();
+            getSharedData()->requests_[actor_id] = request;
+            return true;
+        }
+        getSharedData()->outputResult("{\"id\":" + toJSONString(request->id_) + ",\"error\":" + toJSONString(error) + "}");
+    }
+    return false;
+}
+
+std::string AnalysisSlaveThread::setUpPosition(const std::shared_ptr<BaseActor>& actor, const AnalysisRequest& request)
+{
+    EnvironmentLoader env_loader;
+    if (!env_loader.loadFromString(request.sgf_)) { return "failed to load the sgf"; }
+    const std::vector<std::pair<Action, EnvironmentLoader::ActionInfo>>& action_pairs = env_loader.getActionPairs();
+    const int num_moves = (request.move_number_ < 0 ? action_pairs.size() : std::min<int>(request.move_number_, action_pairs.size()));
+    for (int i = 0; i < num_moves; ++i) {
+        if (!actor->act(action_pairs[i].first)) { return "illegal move at move number " + std::to_string(i + 1); }
+    }
+    if (actor->isEnvTerminal()) { return "the position is terminal"; }
+    return "";
+}
+
+std::string AnalysisSlaveThread::getAnalysisResult(const std::shared_ptr<ZeroActor>& actor, const AnalysisRequest& request)
+{
+    // the values are from the perspective of the player to move
+    const Environment& env = actor->getEnvironment();
+    const env::Player turn = env.getTurn();
+    auto getValue = [turn](float value) { return (turn == env::Player::kPlayer1 ? value : -value); };
+
+    const MCTSNode* root = actor->getMCTS()->getRootNode();
+    std::vector<MCTSNode*> children;
+    for (MCTSNode* child : root->getChildren()) {
+        if (!child->isRest() && child->getCount() > 0) { children.push_back(child); }
+    }
+    std::sort(children.begin(), children.end(), [](const MCTSNode* lhs, const MCTSNode* rhs) { return lhs->getCount() > rhs->getCount(); });
+
+    std::ostringstream oss;
+    oss << "{\"id\":" << toJSONString(request.id_)
+        << ",\"move_number\":" << env.getActionHistory().size()
+        << ",\"turn\":\"" << env::playerToChar(turn) << "\""
+        << ",\"visits\":" << root->getCount()
+        << ",\"value\":" << getValue(root->getMean())
+        << ",\"action\":" << toJSONString(actor->getSearchAction().toConsoleString())
+        << ",\"moves\":[";
+    for (size_t i = 0; i < children.size(); ++i) {
+        const MCTSNode* child = children[i];
+        oss << (i == 0 ? "" : ",")
+            << "{\"action\":" << toJSONString(child->getAction().toConsoleString())
+            << ",\"visits\":" << child->getCount()
+            << ",\"value\":" << getValue(child->getReward() + config::actor_mcts_reward_discount * child->getMean())
+            << ",\"policy\":" << child->getPolicy()
+            << ",\"pv\":" << getPV(child) << "}";
+    }
+    oss << "]}";
+    return oss.str();
+}
+
+std::string AnalysisSlaveThread::getPV(const MCTSNode* node)
+{
+    // follow the most visited children from the node
+    std::ostringstream oss;
+    oss << "[" << toJSONString(node->getAction().toConsoleString());
+    while (!node->isLeaf()) {
+        const MCTSNode* next_node = nullptr;
+        for (const MCTSNode* child : node->getChildren()) {
+            if (child->isRest() || child->getCount() == 0 || (next_node && child->getCount() <= next_node->getCount())) { continue; }
+            next_node = child;
+        }
+        if (!next_node) { break; }
+        node = next_node;
+        oss << "," << toJSONString(node->getAction().toConsoleString());
+    }
+    oss << "]";
+    return oss.str();
+}
+
+void AnalysisGroup::run()
+{
+    initialize();
+    while (true) {
+        handleCommand();
+
+        // wait for requests between the phases, and stop once all requests of the closed input are searched
+        const bool is_idle = (getSharedData()->do_cpu_job_ && !getSharedData()->isAnalyzing());
+        if (is_idle && is_input_closed_) {
+            std::lock_guard lock(command_mutex_);
+            if (commands_.empty()) { break; }
+        }
+        if (is_idle || !running_) {
+            boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+            continue;
+        }
+        runPhase();
+    }
+}
+
+void AnalysisGroup::initialize()
+{
+    ActorGroup::initialize();
+    getSharedData()->requests_.resize(getSharedData()->actors_.size());
+    config::actor_playout_cap_fast_ratio = 0.0f; // every position is searched fully
+    running_ = true;
+}
+
+void AnalysisGroup::handleIO()
+{
+    ActorGroup::handleIO();
+    is_input_closed_ = true;
+}
+
+void AnalysisGroup::handleCommand(const std::string& command_prefix, const std::string& command)
+{
+    if (command_prefix == "analyze") {
+        std::shared_ptr<AnalysisRequest> request = std::make_shared<AnalysisRequest>();
+        std::istringstream iss(command.substr(command_prefix.size()));
+        iss >> request->id_ >> request->move_number_;
+        std::getline(iss, request->sgf_);
+        if (iss.fail() || request->sgf_.find_first_not_of(' ') == std::string::npos) {
+            getSharedData()->outputResult("{\"id\":" + toJSONString(request->id_) + ",\"error\":\"usage: analyze <id> <move_number> <sgf>\"}");
+            return;
+        }
+        request->sgf_ = request->sgf_.substr(request->sgf_.find_first_not_of(' '));
+        std::lock_guard lock(getSharedData()->mutex_);
+        getSharedData()->pending_requests_.push_back(request);
+    } else if (command_prefix != "reset_actors") { // the actors are reset by each request
+        ActorGroup::handleCommand(command_prefix, command);
+    }
+}
+
+} // namespace minizero::actor
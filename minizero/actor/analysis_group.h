@@ -0,0 +1,66 @@
+#pragma once
+
+#include "actor_group.h"
+#include "zero_actor.h"
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace minizero::actor {
+
+class AnalysisRequest {
+public:
+    std::string id_;
+    int move_number_; // the number of moves of the record played before the search, -1 for all moves
+    std::string sgf_;
+};
+
+class AnalysisSharedData : public ThreadSharedData {
+public:
+    std::shared_ptr<AnalysisRequest> popRequest();
+    void outputResult(const std::string& result);
+    bool isAnalyzing();
+
+    std::deque<std::shared_ptr<AnalysisRequest>> pending_requests_;
+    std::vector<std::shared_ptr<AnalysisRequest>> requests_; // the request searched by each actor, nullptr for an idle actor
+};
+
+class AnalysisSlaveThread : public SlaveThread {
+public:
+    AnalysisSlaveThread(int id, std::shared_ptr<utils::BaseSharedData> shared_data)
+        : SlaveThread(id, shared_data) {}
+
+protected:
+    bool doCPUJob() override;
+    void handleSearchDone(int actor_id) override;
+    virtual bool startAnalysis(int actor_id);
+    virtual std::string setUpPosition(const std::shared_ptr<BaseActor>& actor, const AnalysisRequest& request);
+    virtual std::string getAnalysisResult(const std::shared_ptr<ZeroActor>& actor, const AnalysisRequest& request);
+    std::string getPV(const MCTSNode* node);
+    inline std::shared_ptr<AnalysisSharedData> getSharedData() { return std::static_pointer_cast<AnalysisSharedData>(shared_data_); }
+};
+
+// searches the positions of "analyze <id> <move_number> <sgf>" requests from std::cin, one search per actor, and writes a JSON line
+// to std::cout as each search finishes; the searches of all actors run in the phases of ActorGroup, so their leaves share network batches
+class AnalysisGroup : public ActorGroup {
+public:
+    AnalysisGroup() : is_input_closed_(false) {}
+
+    void run();
+    void initialize() override;
+
+protected:
+    void handleIO() override;
+    using ActorGroup::handleCommand;
+    void handleCommand(const std::string& command_prefix, const std::string& command) override;
+
+    void createSharedData() override { shared_data_ = std::make_shared<AnalysisSharedData>(); }
+    std::shared_ptr<utils::BaseSlaveThread> newSlaveThread(int id) override { return std::make_shared<AnalysisSlaveThread>(id, shared_data_); }
+    inline std::shared_ptr<AnalysisSharedData> getSharedData() { return std::static_pointer_cast<AnalysisSharedData>(shared_data_); }
+
+    std::atomic<bool> is_input_closed_;
+};
+
+} // namespace minizero::actor
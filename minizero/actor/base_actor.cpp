@@ -59,7 +59,12 @@ std::string BaseActor::getRecord(const std::unordered_map<std::string, std::stri
 std::vector<std::pair<std::string, std::string>> BaseActor::getActionInfo() const
 {
     std::vector<std::pair<std::string, std::string>> action_info;
-    action_info.push_back({"P", getMCTSPolicy()});
+    // a position without a policy target is marked by F, as a missing P is the played action for records of other sources
+    if (isPolicyTarget()) {
+        action_info.push_back({"P", getMCTSPolicy()});
+    } else {
+        action_info.push_back({"F", "1"});
+    }
     action_info.push_back({"V", getMCTSValue()});
     action_info.push_back({"R", getEnvReward()});
     return action_info;
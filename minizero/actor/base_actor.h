@@ -1,8 +1,10 @@
 #pragma once
 
 #include "environment.h"
+#include "inference_service.h"
 #include "network.h"
 #include "search.h"
+#include <atomic>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -20,8 +22,8 @@ public:
 
     virtual void reset();
     virtual void resetSearch();
-    bool act(const Action& action);
-    bool act(const std::vector<std::string>& action_string_args);
+    virtual bool act(const Action& action);
+    virtual bool act(const std::vector<std::string>& action_string_args);
     virtual std::string getRecord(const std::unordered_map<std::string, std::string>& tags = {}) const;
 
     inline bool isEnvTerminal() const { return env_.isTerminal(); }
@@ -41,12 +43,22 @@ public:
     virtual std::string getSearchInfo() const = 0;
     virtual void setNetwork(const std::shared_ptr<network::Network>& network) = 0;
     virtual std::shared_ptr<Search> createSearch() = 0;
+    // search the position of the opponent's turn in the background until stopped, for a warm start of the next think()
+    virtual void ponder(const std::atomic<bool>& stop_ponder, int num_simulation) {}
+    // the time limit of the next think() in seconds and its maximum extension, 0 for the configured ones
+    virtual void setThinkTimeLimit(float time_limit, float max_time_limit) {}
+    // the leaves are evaluated by the inference service instead of the batch of the network, nullptr for the batch of the network
+    virtual void setInferenceService(const std::shared_ptr<network::InferenceService>& inference_service) {}
+    // the output of the evaluation submitted to the inference service by beforeNNEvaluation(), waiting until it is done
+    virtual std::shared_ptr<network::NetworkOutput> getNNEvaluationOutput() { return nullptr; }
 
 protected:
     virtual std::vector<std::pair<std::string, std::string>> getActionInfo() const;
     virtual std::string getMCTSPolicy() const = 0;
     virtual std::string getMCTSValue() const = 0;
     virtual std::string getEnvReward() const = 0;
+    // false if the search of the move is not recorded as a policy training target
+    virtual bool isPolicyTarget() const { return true; }
 
     int nn_evaluation_batch_id_;
     Environment env_;
@@ -0,0 +1,119 @@
+#include "benchmark_group.h"
+#include "alphazero_network.h"
+#include "configuration.h"
+#include "environment.h"
+#include "muzero_network.h"
+#include "time_profiler.h"
+#include "zero_actor.h"
+#include <algorithm>
+#include <array>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+
+namespace minizero::actor {
+
+using namespace network;
+using namespace utils;
+
+void BenchmarkSlaveThread::doGPUJob()
+{
+    const int num_devices = getSharedData()->networks_.size() / getSharedData()->num_cohorts_;
+    if (id_ < num_devices) {
+        // the same batch as forwarded by SlaveThread::doGPUJob
+        const std::shared_ptr<Network>& network = getSharedData()->networks_[getSharedData()->gpu_cohort_ * num_devices + id_];
+        int batch_size = 0;
+        if (network->getNetworkTypeName() == "alphazero") {
+            batch_size = std::static_pointer_cast<AlphaZeroNetwork>(network)->getBatchSize();
+        } else if (network->getNetworkTypeName() == "muzero" || network->getNetworkTypeName() == "muzero_atari") {
+            std::shared_ptr<MuZeroNetwork> muzero_network = std::static_pointer_cast<MuZeroNetwork>(network);
+            batch_size = (muzero_network->getInitialInputBatchSize() > 0 ? muzero_network->getInitialInputBatchSize() : muzero_network->getRecurrentInputBatchSize());
+        }
+        if (batch_size > 0) {
+            ++getSharedData()->num_batches_;
+            getSharedData()->num_evaluations_ += batch_size;
+        }
+    }
+    SlaveThread::doGPUJob();
+}
+
+void BenchmarkSlaveThread::handleSearchDone(int actor_id)
+{
+    std::shared_ptr<ZeroActor> actor = std::static_pointer_cast<ZeroActor>(getSharedData()->actors_[actor_id]);
+    ++getSharedData()->num_moves_;
+    getSharedData()->num_simulations_ += actor->getNumSearchedSimulations();
+    SlaveThread::handleSearchDone(actor_id);
+}
+
+void BenchmarkGroup::run()
+{
+    initialize();
+    start_time_ = std::chrono::steady_clock::now();
+    while (!isFinished()) { runPhase(); }
+    report();
+}
+
+void BenchmarkGroup::initialize()
+{
+    assert(config::zero_benchmark_num_moves > 0 || config::zero_benchmark_num_seconds > 0);
+    TimeProfiler::enable(); // before the slave threads start
+    ActorGroup::initialize();
+    running_ = true;
+}
+
+std::shared_ptr<Network> BenchmarkGroup::newNetwork(int gpu_id)
+{
+    if (!config::nn_file_name.empty()) { return ActorGroup::newNetwork(gpu_id); }
+
+    Environment env;
+    return std::make_shared<SyntheticAlphaZeroNetwork>(env.name(), env.getNumInputChannels(), env.getInputChannelHeight(), env.getInputChannelWidth(), env.getPolicySize());
+}
+
+bool BenchmarkGroup::isFinished()
+{
+    // checked between the phases, so a few more moves than the limit may be played
+    if (config::zero_benchmark_num_moves > 0 && getSharedData()->num_moves_ >= static_cast<uint64_t>(config::zero_benchmark_num_moves)) { return true; }
+    const double elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time_).count();
+    return (config::zero_benchmark_num_seconds > 0 && elapsed_seconds >= config::zero_benchmark_num_seconds);
+}
+
+void BenchmarkGroup::report()
+{
+    const double elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time_).count();
+    std::shared_ptr<BenchmarkSharedData> shared_data = getSharedData();
+    uint64_t num_batches = shared_data->num_batches_;
+    uint64_t num_evaluations = shared_data->num_evaluations_;
+    int batch_capacity = (config::zero_num_parallel_games + shared_data->networks_.size() - 1) / shared_data->networks_.size(); // the actors of a network
+    for (const auto& inference_service : shared_data->inference_services_) {
+        num_batches += inference_service->getNumBatches();
+        num_evaluations += inference_service->getNumEvaluations();
+        batch_capacity = inference_service->getMaxBatchSize();
+    }
+    const double average_batch_size = (num_batches == 0 ? 0.0 : static_cast<double>(num_evaluations) / num_batches);
+
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(2);
+    oss << "model: " << (config::nn_file_name.empty() ? "synthetic" : config::nn_file_name)
+        << ", " << slave_threads_.size() << " threads, " << shared_data->actors_.size() << " actors, " << shared_data->networks_.size() << " networks"
+        << (shared_data->inference_services_.empty() ? "" : " with inference services") << std::endl;
+    oss << "elapsed seconds: " << elapsed_seconds << std::endl;
+    oss << "moves: " << shared_data->num_moves_ << " (" << shared_data->num_moves_ / elapsed_seconds << "/sec), games: " << shared_data->num_games_ << std::endl;
+    oss << "simulations: " << shared_data->num_simulations_ << " (" << shared_data->num_simulations_ / elapsed_seconds << "/sec)" << std::endl;
+    oss << "nn evaluations: " << num_evaluations << " (" << num_evaluations / elapsed_seconds << "/sec) in " << num_batches << " batches" << std::endl;
+    oss << "average batch size: " << average_batch_size << " of " << batch_capacity << " (fill " << 100.0 * average_batch_size / batch_capacity << "%)" << std::endl;
+
+    // the stages overlap between the threads, so their sum may exceed the elapsed time
+    const std::array<double, TimeProfiler::kNumStages> seconds = TimeProfiler::getSeconds();
+    const double total_seconds = std::max(1e-9, std::accumulate(seconds.begin(), seconds.end(), 0.0));
+    oss << "time split (seconds summed over the threads):" << std::endl;
+    for (int stage = 0; stage < TimeProfiler::kNumStages; ++stage) {
+        oss << "  " << std::left << std::setw(20) << TimeProfiler::getStageName(static_cast<TimeProfiler::Stage>(stage)) << std::right
+            << std::setw(10) << seconds[stage] << std::setw(8) << 100.0 * seconds[stage] / total_seconds << "%" << std::endl;
+    }
+
+    std::lock_guard lock(shared_data->mutex_);
+    std::cout << oss.str() << std::flush;
+}
+
+} // namespace minizero::actor
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "actor_group.h"
+#include "network.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace minizero::actor {
+
+class BenchmarkSharedData : public ThreadSharedData {
+public:
+    void writeGame(const std::string& game_record) override { ++num_games_; } // the records are dropped, their output is measured by the time profiler
+
+    std::atomic<uint64_t> num_moves_{0};
+    std::atomic<uint64_t> num_simulations_{0};
+    std::atomic<uint64_t> num_games_{0};
+    std::atomic<uint64_t> num_batches_{0};     // without inference services, which count their own batches
+    std::atomic<uint64_t> num_evaluations_{0}; // without inference services
+};
+
+class BenchmarkSlaveThread : public SlaveThread {
+public:
+    BenchmarkSlaveThread(int id, std::shared_ptr<utils::BaseSharedData> shared_data)
+        : SlaveThread(id, shared_data) {}
+
+protected:
+    void doGPUJob() override;
+    void handleSearchDone(int actor_id) override;
+    inline std::shared_ptr<BenchmarkSharedData> getSharedData() { return std::static_pointer_cast<BenchmarkSharedData>(shared_data_); }
+};
+
+// plays self-play games through the phases of ActorGroup for zero_benchmark_num_moves moves or zero_benchmark_num_seconds seconds,
+// whichever comes first, and writes the throughput and the time split of the stages to std::cout; the game records are not written
+// the model is nn_file_name, or a synthetic alphazero network of uniform policy and zero value if it is empty
+class BenchmarkGroup : public ActorGroup {
+public:
+    BenchmarkGroup() {}
+
+    void run();
+    void initialize() override;
+
+protected:
+    void handleIO() override {} // the benchmark takes no commands
+    std::shared_ptr<network::Network> newNetwork(int gpu_id) override;
+    virtual bool isFinished();
+    virtual void report();
+
+    void createSharedData() override { shared_data_ = std::make_shared<BenchmarkSharedData>(); }
+    std::shared_ptr<utils::BaseSlaveThread> newSlaveThread(int id) override { return std::make_shared<BenchmarkSlaveThread>(id, shared_data_); }
+    inline std::shared_ptr<BenchmarkSharedData> getSharedData() { return std::static_pointer_cast<BenchmarkSharedData>(shared_data_); }
+
+    std::chrono::steady_clock::time_point start_time_;
+};
+
+} // namespace minizero::actor
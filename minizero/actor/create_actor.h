@@ -3,13 +3,62 @@
 #include "base_actor.h"
 #include "configuration.h"
 #include "zero_actor.h"
+#include <algorithm>
 #include <memory>
+#include <vector>
 
 namespace minizero::actor {
 
-inline std::shared_ptr<actor::BaseActor> createActor(uint64_t tree_node_size, const std::shared_ptr<network::Network>& network)
+// the number of tree nodes needed by a search, where every simulation expands at most one node
+inline uint64_t getTreeNodeSize(const std::shared_ptr<network::Network>& network)
 {
-    auto actor = std::make_shared<ZeroActor>(tree_node_size);
+    const uint64_t num_simulation = config::actor_num_simulation + 1;
+    const uint64_t action_size = network->getActionSize();
+    if (network->getNetworkTypeName() != "alphazero" || config::actor_mcts_expand_top_k <= 0) { return num_simulation * action_size; }
+
+    // the root has all children, and every simulation expands a node and widens another one by at most top_k children and a rest node
+    const uint64_t block_size = std::min<uint64_t>(config::actor_mcts_expand_top_k, action_size) + 1;
+    return action_size + 2 * num_simulation * block_size;
+}
+
+// the pool shared by the trees of num_trees actors, whose chunks are a huge page unless a tree or a block of children needs another size
+inline std::shared_ptr<TreeNodePool> createTreeNodePool(uint64_t tree_node_size, const std::shared_ptr<network::Network>& network, int num_trees, int numa_node = -1)
+{
+    uint64_t chunk_node_size = std::max<uint64_t>(TreeNodePool::kHugePageSize / sizeof(MCTSNode), 2 * (network->getActionSize() + 1));
+    chunk_node_size = std::min(chunk_node_size, 1 + tree_node_size);
+    const uint64_t num_chunks = num_trees * MCTS::getMaxNumChunks(tree_node_size, chunk_node_size);
+    TreeNodePool::HugePage huge_page = TreeNodePool::HugePage::kNone;
+    if (config::actor_tree_huge_page == "transparent") {
+        huge_page = TreeNodePool::HugePage::kTransparent;
+    } else if (config::actor_tree_huge_page == "explicit") {
+        huge_page = TreeNodePool::HugePage::kExplicit;
+    } else {
+        assert(config::actor_tree_huge_page == "none");
+    }
+    return std::make_shared<TreeNodePool>(chunk_node_size * sizeof(MCTSNode), num_chunks, huge_page, numa_node);
+}
+
+// the network outputs shared by all actors, nullptr if disabled or not supported by the network
+inline std::shared_ptr<EvaluationCache> createEvaluationCache(const std::shared_ptr<network::Network>& network)
+{
+    if (config::actor_mcts_evaluation_cache_size <= 0 || network->getNetworkTypeName() != "alphazero") { return nullptr; }
+    std::shared_ptr<EvaluationCache> evaluation_cache = std::make_shared<EvaluationCache>(config::actor_mcts_evaluation_cache_size, network->getActionSize());
+    if (config::actor_use_random_rotation_features) {
+        // the rotations of the features are the same for every position of the board
+        Environment env;
+        env.reset();
+        std::vector<std::vector<int>> rotate_positions(static_cast<int>(utils::Rotation::kRotateSize), std::vector<int>(network->getInputChannelHeight() * network->getInputChannelWidth()));
+        for (int rotation = 0; rotation < static_cast<int>(utils::Rotation::kRotateSize); ++rotation) {
+            for (size_t pos = 0; pos < rotate_positions[rotation].size(); ++pos) { rotate_positions[rotation][pos] = env.getRotatePosition(pos, static_cast<utils::Rotation>(rotation)); }
+        }
+        evaluation_cache->setRotatePositions(rotate_positions);
+    }
+    return evaluation_cache;
+}
+
+inline std::shared_ptr<actor::BaseActor> createActor(uint64_t tree_node_size, const std::shared_ptr<network::Network>& network, const std::shared_ptr<TreeNodePool>& tree_node_pool = nullptr, const std::shared_ptr<EvaluationCache>& evaluation_cache = nullptr)
+{
+    auto actor = std::make_shared<ZeroActor>(tree_node_size, tree_node_pool, evaluation_cache);
     actor->setNetwork(network);
     actor->reset();
     return actor;
@@ -0,0 +1,136 @@
+#include "evaluation_cache.h"
+#include "half.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace minizero::actor {
+
+namespace {
+
+// splitmix64, so that the hashes of all features are summed in any order
+inline uint64_t mixFeature(uint64_t index, float feature)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &feature, sizeof(bits));
+    uint64_t x = (index << 32 | bits) + 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+} // namespace
+
+EvaluationCache::EvaluationCache(int num_entries, int policy_size)
+    : policy_size_(policy_size),
+      num_sets_(std::max(1, num_entries / (kNumShards * kNumWays))),
+      shards_(new Shard[kNumShards])
+{
+    assert(num_entries > 0 && policy_size > 0);
+    for (int i = 0; i < kNumShards; ++i) {
+        Shard& shard = shards_[i];
+        shard.keys_.resize(num_sets_ * kNumWays);
+        shard.values_.resize(num_sets_ * kNumWays);
+        shard.last_used_ticks_.resize(num_sets_ * kNumWays);
+        shard.policy_logits_.resize(num_sets_ * kNumWays * policy_size_);
+    }
+    clear();
+}
+
+std::pair<uint64_t, utils::Rotation> EvaluationCache::getKey(const std::vector<float>& features) const
+{
+    const int num_rotations = (rotate_positions_.empty() ? 1 : rotate_positions_.size());
+    const size_t plane_size = (rotate_positions_.empty() ? features.size() : rotate_positions_[0].size());
+    assert(plane_size > 0 && features.size() % plane_size == 0);
+    uint64_t hashes[static_cast<int>(utils::Rotation::kRotateSize)] = {};
+    for (size_t i = 0; i < features.size(); ++i) {
+        if (features[i] == 0.0f) { continue; } // most features of board games are empty
+        if (rotate_positions_.empty()) {
+            hashes[0] += mixFeature(i, features[i]);
+            continue;
+        }
+        const size_t plane_start = i - i % plane_size;
+        for (int rotation = 0; rotation < num_rotations; ++rotation) { hashes[rotation] += mixFeature(plane_start + rotate_positions_[rotation][i % plane_size], features[i]); }
+    }
+    const int rotation = std::min_element(hashes, hashes + num_rotations) - hashes;
+    return {std::max<uint64_t>(hashes[rotation], 1), static_cast<utils::Rotation>(rotation)};
+}
+
+std::vector<float> EvaluationCache::rotateFeatures(const std::vector<float>& features, utils::Rotation rotation) const
+{
+    if (rotate_positions_.empty() || rotation == utils::Rotation::kRotationNone) { return features; }
+    const std::vector<int>& rotate_positions = rotate_positions_[static_cast<int>(rotation)];
+    const size_t plane_size = rotate_positions.size();
+    assert(plane_size > 0 && features.size() % plane_size == 0);
+    std::vector<float> rotated_features(features.size());
+    for (size_t plane_start = 0; plane_start < features.size(); plane_start += plane_size) {
+        for (size_t pos = 0; pos < plane_size; ++pos) { rotated_features[plane_start + rotate_positions[pos]] = features[plane_start + pos]; }
+    }
+    return rotated_features;
+}
+
+bool EvaluationCache::lookup(uint64_t key, network::AlphaZeroNetworkOutput& output)
+{
+    assert(key != 0 && static_cast<int>(output.policy_logits_.size()) == policy_size_);
+    ++num_lookups_;
+    Shard& shard = getShard(key);
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex_);
+        const int first_entry = getFirstEntry(key);
+        int entry = first_entry;
+        while (entry < first_entry + kNumWays && shard.keys_[entry] != key) { ++entry; }
+        if (entry == first_entry + kNumWays) { return false; }
+        shard.last_used_ticks_[entry] = ++shard.tick_;
+        output.value_ = shard.values_[entry];
+        const uint16_t* policy_logits = &shard.policy_logits_[static_cast<size_t>(entry) * policy_size_];
+        for (int i = 0; i < policy_size_; ++i) { output.policy_logits_[i] = utils::Half::halfToFloat(policy_logits[i]); }
+    }
+    ++num_hits_;
+
+    const float max_logit = *std::max_element(output.policy_logits_.begin(), output.policy_logits_.end());
+    float sum = 0.0f;
+    for (int i = 0; i < policy_size_; ++i) { sum += (output.policy_[i] = std::exp(output.policy_logits_[i] - max_logit)); }
+    for (int i = 0; i < policy_size_; ++i) { output.policy_[i] /= sum; }
+    return true;
+}
+
+void EvaluationCache::store(uint64_t key, const network::AlphaZeroNetworkOutput& output)
+{
+    assert(key != 0 && static_cast<int>(output.policy_logits_.size()) == policy_size_);
+    Shard& shard = getShard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex_);
+    const int first_entry = getFirstEntry(key);
+    int entry = first_entry;
+    for (int i = first_entry; i < first_entry + kNumWays; ++i) {
+        if (shard.keys_[i] == key || shard.keys_[i] == 0) { // already stored by another search, or empty
+            entry = i;
+            break;
+        }
+        if (shard.last_used_ticks_[i] < shard.last_used_ticks_[entry]) { entry = i; }
+    }
+    if (shard.keys_[entry] == 0) {
+        ++num_used_entries_;
+    } else if (shard.keys_[entry] != key) {
+        ++num_evictions_;
+    }
+    shard.keys_[entry] = key;
+    shard.values_[entry] = output.value_;
+    shard.last_used_ticks_[entry] = ++shard.tick_;
+    uint16_t* policy_logits = &shard.policy_logits_[static_cast<size_t>(entry) * policy_size_];
+    for (int i = 0; i < policy_size_; ++i) { policy_logits[i] = utils::Half::floatToHalf(output.policy_logits_[i]); }
+}
+
+void EvaluationCache::clear()
+{
+    for (int i = 0; i < kNumShards; ++i) {
+        Shard& shard = shards_[i];
+        std::lock_guard<std::mutex> lock(shard.mutex_);
+        shard.tick_ = 0;
+        std::fill(shard.keys_.begin(), shard.keys_.end(), 0);
+        std::fill(shard.last_used_ticks_.begin(), shard.last_used_ticks_.end(), 0);
+    }
+    num_used_entries_ = num_lookups_ = num_hits_ = num_evictions_ = 0;
+}
+
+} // namespace minizero::actor
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "alphazero_network.h"
+#include "rotation.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace minizero::actor {
+
+// AlphaZero network outputs shared by the searches of all actors and moves, until clear() when the model is reloaded
+// a position is keyed by the hash of its input features, which include the history needed by the network, so an entry is only
+// reused for the same network input; the policy logits are stored in fp16, and the policy is the softmax of them
+// the entries are split into shards locked separately, each a set-associative table replacing the least recently used entry of a full set
+class EvaluationCache {
+public:
+    EvaluationCache(int num_entries, int policy_size);
+    EvaluationCache(const EvaluationCache&) = delete;
+    EvaluationCache& operator=(const EvaluationCache&) = delete;
+
+    // rotate_positions[r][pos] is the position of pos in the features of rotation r, i.e., getRotatePosition(pos, r) of the environment;
+    // with it, the rotations of a position share an entry, which is evaluated in the rotation of the minimum feature hash
+    inline void setRotatePositions(const std::vector<std::vector<int>>& rotate_positions) { rotate_positions_ = rotate_positions; }
+
+    // the key of the features of kRotationNone, and the rotation the position should be evaluated in
+    std::pair<uint64_t, utils::Rotation> getKey(const std::vector<float>& features) const;
+    // the features of kRotationNone in a rotation, the same as getFeatures(rotation) of the environment without extracting them again
+    std::vector<float> rotateFeatures(const std::vector<float>& features, utils::Rotation rotation) const;
+
+    // thread-safe
+    bool lookup(uint64_t key, network::AlphaZeroNetworkOutput& output);
+    void store(uint64_t key, const network::AlphaZeroNetworkOutput& output);
+    void clear();
+
+    inline int getPolicySize() const { return policy_size_; }
+    inline uint64_t getNumEntries() const { return kNumShards * num_sets_ * kNumWays; }
+    inline uint64_t getNumUsedEntries() const { return num_used_entries_; }
+    inline uint64_t getMemorySize() const { return getNumEntries() * (sizeof(uint64_t) + sizeof(float) + sizeof(uint32_t) + policy_size_ * sizeof(uint16_t)); }
+    inline uint64_t getNumLookups() const { return num_lookups_; }
+    inline uint64_t getNumHits() const { return num_hits_; }
+    inline uint64_t getNumEvictions() const { return num_evictions_; }
+
+    static const int kNumShards = 64;
+    static const int kNumWays = 4;
+
+private:
+    class Shard {
+    public:
+        std::mutex mutex_;
+        uint32_t tick_;
+        std::vector<uint64_t> keys_; // 0 for an empty entry
+        std::vector<float> values_;
+        std::vector<uint32_t> last_used_ticks_;
+        std::vector<uint16_t> policy_logits_; // policy_size_ per entry
+    };
+
+    inline Shard& getShard(uint64_t key) const { return shards_[(key >> 32) % kNumShards]; }
+    inline int getFirstEntry(uint64_t key) const { return (key % num_sets_) * kNumWays; }
+
+    int policy_size_;
+    uint64_t num_sets_; // per shard
+    std::unique_ptr<Shard[]> shards_;
+    std::vector<std::vector<int>> rotate_positions_;
+    std::atomic<uint64_t> num_used_entries_;
+    std::atomic<uint64_t> num_lookups_;
+    std::atomic<uint64_t> num_hits_;
+    std::atomic<uint64_t> num_evictions_;
+};
+
+} // namespace minizero::actor
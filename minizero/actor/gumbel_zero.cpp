@@ -49,6 +49,7 @@ MCTSNode* GumbelZero::decideActionNode(const std::shared_ptr<MCTS>& mcts)
     if (config::actor_select_action_by_count) {
         assert(candidates_.size() > 0);
         sortCandidatesByScore();
+        resetSchedule();
         return candidates_[0];
     } else if (config::actor_select_action_by_softmax_count) {
         return mcts->selectChildBySoftmaxCount(mcts->getRootNode(), config::actor_select_action_softmax_temperature);
@@ -64,11 +65,13 @@ std::vector<MCTSNode*> GumbelZero::selection(const std::shared_ptr<MCTS>& mcts)
     if (mcts->getNumSimulation() == 0) {
         node_path = mcts->select();
     } else {
-        assert(candidates_.size() > 0);
-        sort(candidates_.begin(), candidates_.end(), [](const MCTSNode* lhs, const MCTSNode* rhs) {
-            return (lhs->getCount() < rhs->getCount() || (lhs->getCount() == rhs->getCount() && lhs->getPolicyLogit() > rhs->getPolicyLogit()));
-        });
-        node_path = mcts->selectFromNode(candidates_[0]);
+        assert(!schedule_heap_.empty());
+        auto later_scheduled = [this](int lhs, int rhs) { return isScheduledLater(lhs, rhs); };
+        std::pop_heap(schedule_heap_.begin(), schedule_heap_.end(), later_scheduled);
+        const int index = schedule_heap_.back();
+        ++scheduled_counts_[index];
+        std::push_heap(schedule_heap_.begin(), schedule_heap_.end(), later_scheduled);
+        node_path = mcts->selectFromNode(candidates_[index]);
         node_path.insert(node_path.begin(), mcts->getRootNode());
     }
     return node_path;
@@ -84,7 +87,9 @@ void GumbelZero::sequentialHalving(const std::shared_ptr<MCTS>& mcts)
         if (static_cast<int>(candidates_.size()) > config::actor_gumbel_sample_size) { candidates_.resize(config::actor_gumbel_sample_size); }
         sample_size_ = config::actor_gumbel_sample_size;
         simulation_budget_ = std::max(1.0, std::floor(config::actor_num_simulation / (std::log2(config::actor_gumbel_sample_size) * sample_size_)));
-    } else {
+        resetSchedule();
+    } else if (!schedule_heap_.empty() && scheduled_counts_[schedule_heap_.front()] >= simulation_budget_) {
+        // the counts are only checked once all candidates are scheduled up to the budget
         bool all_candidates_reach_budget = true;
         for (auto node : candidates_) {
             if (node->getCount() >= simulation_budget_) { continue; }
@@ -92,7 +97,10 @@ void GumbelZero::sequentialHalving(const std::shared_ptr<MCTS>& mcts)
             break;
         }
 
-        if (all_candidates_reach_budget) {
+        if (!all_candidates_reach_budget) {
+            // some scheduled selections are not backed up, or dropped since their leaves were already being evaluated
+            resetSchedule();
+        } else {
             int next_budget = std::floor(config::actor_num_simulation / (std::log2(config::actor_gumbel_sample_size) * sample_size_ / 2));
             if (next_budget > 0 && sample_size_ > 2) {
                 sample_size_ /= 2;
@@ -100,11 +108,25 @@ void GumbelZero::sequentialHalving(const std::shared_ptr<MCTS>& mcts)
                 sortCandidatesByScore();
                 if (static_cast<int>(candidates_.size()) > sample_size_) { candidates_.resize(sample_size_); }
                 simulation_budget_ = candidates_[0]->getCount() + next_budget;
+                resetSchedule();
+            } else {
+                simulation_budget_ = std::numeric_limits<int>::max(); // the last phase lasts until the search is done
             }
         }
     }
 }
 
+void GumbelZero::resetSchedule()
+{
+    scheduled_counts_.resize(candidates_.size());
+    schedule_heap_.resize(candidates_.size());
+    for (size_t i = 0; i < candidates_.size(); ++i) {
+        scheduled_counts_[i] = candidates_[i]->getCount();
+        schedule_heap_[i] = i;
+    }
+    std::make_heap(schedule_heap_.begin(), schedule_heap_.end(), [this](int lhs, int rhs) { return isScheduledLater(lhs, rhs); });
+}
+
 void GumbelZero::sortCandidatesByScore()
 {
     assert(!candidates_.empty());
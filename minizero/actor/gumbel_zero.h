@@ -16,9 +16,19 @@ public:
     void sortCandidatesByScore();
 
 private:
+    void resetSchedule();
+    inline bool isScheduledLater(int lhs, int rhs) const
+    {
+        return (scheduled_counts_[lhs] > scheduled_counts_[rhs] || (scheduled_counts_[lhs] == scheduled_counts_[rhs] && candidates_[lhs]->getPolicyLogit() < candidates_[rhs]->getPolicyLogit()));
+    }
+
     int sample_size_;
     int simulation_budget_;
     std::vector<MCTSNode*> candidates_;
+    // the candidates are selected by a min-heap of their scheduled counts, i.e., their counts plus the selections not yet backed up,
+    // so that a selection costs O(log k) and the selections of a batch are spread over the candidates
+    std::vector<int> scheduled_counts_;
+    std::vector<int> schedule_heap_; // indices of candidates_, the fewest scheduled count first, then the highest policy logit
 };
 
 } // namespace minizero::actor
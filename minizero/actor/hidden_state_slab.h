@@ -0,0 +1,129 @@
+#pragma once
+
+#include "half.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace minizero::actor {
+
+// MuZero hidden states of a search tree, stored back to back in fixed-size records of large chunks
+// a record is never moved until the next keep or reset, so it can be copied to a network batch directly from its pointer
+// the chunks are kept by reset and reused by the next search
+class HiddenStateSlab {
+public:
+    enum class Precision {
+        kFloat,   // fp32
+        kHalf,    // fp16, utils::Half
+        kBFloat16 // bf16, utils::BFloat16
+    };
+
+    explicit HiddenStateSlab(Precision precision = Precision::kFloat)
+        : precision_(precision),
+          hidden_state_size_(0),
+          record_size_(0),
+          num_records_per_chunk_(0),
+          size_(0) {}
+
+    inline void reset() { size_ = 0; }
+
+    // thread-safe against other stores, but not against reads of other records
+    inline int store(const std::vector<float>& hidden_state)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (record_size_ == 0) { setHiddenStateSize(hidden_state.size()); }
+        assert(static_cast<int>(hidden_state.size()) == hidden_state_size_);
+        const int index = size_++;
+        if (index / num_records_per_chunk_ >= static_cast<int>(chunks_.size())) { chunks_.emplace_back(new char[num_records_per_chunk_ * record_size_]); }
+        encode(hidden_state.data(), getRecord(index));
+        return index;
+    }
+
+    // the raw record of getRecordSize() bytes, encoded in getPrecision()
+    inline const void* getHiddenState(int index) const
+    {
+        assert(index >= 0 && index < size_);
+        return getRecord(index);
+    }
+    inline std::vector<float> loadHiddenState(int index) const
+    {
+        std::vector<float> hidden_state(hidden_state_size_);
+        decode(getHiddenState(index), hidden_state.data());
+        return hidden_state;
+    }
+    inline int size() const { return size_; }
+
+    // keep only the records at the given indices, in the given order
+    inline void keep(const std::vector<int>& indices)
+    {
+        if (indices.empty() || record_size_ == 0) { return reset(); }
+        std::vector<std::unique_ptr<char[]>> chunks;
+        for (size_t i = 0; i < indices.size(); ++i) {
+            assert(indices[i] >= 0 && indices[i] < size_);
+            if (i % num_records_per_chunk_ == 0) { chunks.emplace_back(new char[num_records_per_chunk_ * record_size_]); }
+            std::memcpy(chunks.back().get() + (i % num_records_per_chunk_) * record_size_, getRecord(indices[i]), record_size_);
+        }
+        chunks_.swap(chunks);
+        size_ = indices.size();
+    }
+
+    inline Precision getPrecision() const { return precision_; }
+    inline int getHiddenStateSize() const { return hidden_state_size_; }
+    inline int getRecordSize() const { return record_size_; }
+
+    static inline Precision toPrecision(const std::string& precision)
+    {
+        if (precision == "fp16") { return Precision::kHalf; }
+        if (precision == "bf16") { return Precision::kBFloat16; }
+        assert(precision == "fp32");
+        return Precision::kFloat;
+    }
+
+    static const int kChunkSize = 1 << 18;
+
+private:
+    inline void setHiddenStateSize(int hidden_state_size)
+    {
+        hidden_state_size_ = hidden_state_size;
+        record_size_ = hidden_state_size * (precision_ == Precision::kFloat ? sizeof(float) : sizeof(uint16_t));
+        num_records_per_chunk_ = std::max(1, kChunkSize / record_size_);
+    }
+
+    inline char* getRecord(int index) const { return chunks_[index / num_records_per_chunk_].get() + (index % num_records_per_chunk_) * record_size_; }
+
+    inline void encode(const float* hidden_state, char* record) const
+    {
+        if (precision_ == Precision::kFloat) { return (void)std::memcpy(record, hidden_state, record_size_); }
+        uint16_t* bits = reinterpret_cast<uint16_t*>(record);
+        if (precision_ == Precision::kHalf) {
+            for (int i = 0; i < hidden_state_size_; ++i) { bits[i] = utils::Half::floatToHalf(hidden_state[i]); }
+        } else {
+            for (int i = 0; i < hidden_state_size_; ++i) { bits[i] = utils::BFloat16::floatToBFloat16(hidden_state[i]); }
+        }
+    }
+
+    inline void decode(const void* record, float* hidden_state) const
+    {
+        if (precision_ == Precision::kFloat) { return (void)std::memcpy(hidden_state, record, record_size_); }
+        const uint16_t* bits = static_cast<const uint16_t*>(record);
+        if (precision_ == Precision::kHalf) {
+            for (int i = 0; i < hidden_state_size_; ++i) { hidden_state[i] = utils::Half::halfToFloat(bits[i]); }
+        } else {
+            for (int i = 0; i < hidden_state_size_; ++i) { hidden_state[i] = utils::BFloat16::bfloat16ToFloat(bits[i]); }
+        }
+    }
+
+    Precision precision_;
+    int hidden_state_size_; // number of floats, fixed by the first store
+    int record_size_;       // in bytes
+    int num_records_per_chunk_;
+    int size_;
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    std::mutex mutex_;
+};
+
+} // namespace minizero::actor
@@ -0,0 +1,221 @@
+#include "mcts.h"
+#include <algorithm>
+#include <iterator>
+#include <mutex>
+#include <utility>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MCTS_PUCT_AVX2 1
+#endif
+
+namespace minizero::actor {
+
+namespace {
+
+// terms shared by all children of the node being selected from
+class PUCTParentTerms {
+public:
+    float puct_bias_;
+    double sqrt_total_simulation_;
+    bool value_rescale_;
+    bool constant_mean_;
+    float value_lower_bound_;
+    float value_bound_range_;
+};
+
+// structure-of-arrays copy of the children statistics, reused across selections of the same thread
+class PUCTChildStats {
+public:
+    // gather the children in all blocks, skipping rest nodes
+    void gather(const MCTSNode* node)
+    {
+        size_ = 0;
+        num_unproven_ = 0;
+        blocks_.clear();
+        for (const MCTSNode* block = node; block && !block->isLeaf();) {
+            // only the last child of a block may be a rest node
+            const MCTSNode* last_child = block->getChild(block->getNumChildren() - 1);
+            const int num_children = block->getNumChildren() - (last_child->isRest() ? 1 : 0);
+            const MCTSNode* child = block->getChild(0);
+            blocks_.emplace_back(size_, child);
+            resize(size_ + num_children);
+            for (int i = size_; i < size_ + num_children; ++i, ++child) {
+                count_[i] = child->getCount();
+                virtual_loss_[i] = child->getVirtualLoss();
+                count_with_virtual_loss_[i] = child->getCountWithVirtualLoss();
+                policy_[i] = child->getPolicy();
+                mean_[i] = child->getMean();
+                reward_[i] = child->getReward();
+                sign_[i] = (child->getAction().getPlayer() == env::Player::kPlayer1 ? 1.0f : -1.0f);
+                is_proven_[i] = child->isProven();
+                num_unproven_ += (is_proven_[i] ? 0 : 1);
+            }
+            size_ += num_children;
+            block = (last_child->isRest() ? last_child : nullptr);
+        }
+    }
+
+    inline MCTSNode* getChild(int index) const
+    {
+        auto block = std::prev(std::upper_bound(blocks_.begin(), blocks_.end(), std::make_pair(index, static_cast<const MCTSNode*>(nullptr)),
+                                                [](const std::pair<int, const MCTSNode*>& lhs, const std::pair<int, const MCTSNode*>& rhs) { return lhs.first < rhs.first; }));
+        return const_cast<MCTSNode*>(block->second + (index - block->first));
+    }
+
+    int size_ = 0;
+    int num_unproven_ = 0;
+    std::vector<std::pair<int, const MCTSNode*>> blocks_; // (index of the first child, first child) of each block
+    std::vector<float> count_;
+    std::vector<float> virtual_loss_;
+    std::vector<float> count_with_virtual_loss_;
+    std::vector<float> policy_;
+    std::vector<float> mean_;
+    std::vector<float> reward_;
+    std::vector<float> sign_;
+    std::vector<float> value_u_;
+    std::vector<float> value_q_;
+    std::vector<bool> is_proven_;
+
+private:
+    void resize(int size)
+    {
+        if (static_cast<int>(count_.size()) >= size) { return; }
+        for (auto v : {&count_, &virtual_loss_, &count_with_virtual_loss_, &policy_, &mean_, &reward_, &sign_, &value_u_, &value_q_}) { v->resize(size); }
+        is_proven_.resize(size);
+    }
+};
+
+// the arithmetic below mirrors MCTSNode::getNormalizedPUCTScore and MCTSNode::getNormalizedMean operation by operation,
+// so that both paths produce the same scores bit by bit
+inline void computeScoresScalar(const PUCTParentTerms& terms, PUCTChildStats& stats, int begin)
+{
+    for (int i = begin; i < stats.size_; ++i) {
+        stats.value_u_[i] = (terms.puct_bias_ * stats.policy_[i] * terms.sqrt_total_simulation_) / (1 + stats.count_with_virtual_loss_[i]);
+        if (terms.constant_mean_) {
+            stats.value_q_[i] = 1.0f;
+            continue;
+        }
+        float value = stats.reward_[i] + config::actor_mcts_reward_discount * stats.mean_[i];
+        if (terms.value_rescale_) {
+            value = (value - terms.value_lower_bound_) / terms.value_bound_range_;
+            value = fmin(1, fmax(-1, 2 * value - 1));
+        }
+        value = value * stats.sign_[i];
+        stats.value_q_[i] = (value * stats.count_[i] - stats.virtual_loss_[i]) / stats.count_with_virtual_loss_[i];
+    }
+}
+
+#ifdef MCTS_PUCT_AVX2
+__attribute__((target("avx2"))) void computeScoresAVX2(const PUCTParentTerms& terms, PUCTChildStats& stats)
+{
+    const __m256 puct_bias = _mm256_set1_ps(terms.puct_bias_);
+    const __m256d sqrt_total_simulation = _mm256_set1_pd(terms.sqrt_total_simulation_);
+    const __m256 discount = _mm256_set1_ps(config::actor_mcts_reward_discount);
+    const __m256 lower_bound = _mm256_set1_ps(terms.value_lower_bound_);
+    const __m256 bound_range = _mm256_set1_ps(terms.value_bound_range_);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 minus_one = _mm256_set1_ps(-1.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+
+    int i = 0;
+    for (; i + 8 <= stats.size_; i += 8) {
+        const __m256 count = _mm256_loadu_ps(&stats.count_[i]);
+        const __m256 virtual_loss = _mm256_loadu_ps(&stats.virtual_loss_[i]);
+        const __m256 count_with_virtual_loss = _mm256_loadu_ps(&stats.count_with_virtual_loss_[i]);
+
+        // value_u is evaluated in double precision, as sqrt(total_simulation) is a double in the scalar code
+        const __m256 biased_policy = _mm256_mul_ps(puct_bias, _mm256_loadu_ps(&stats.policy_[i]));
+        const __m256 denominator = _mm256_add_ps(one, count_with_virtual_loss);
+        const __m256d value_u_low = _mm256_div_pd(_mm256_mul_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(biased_policy)), sqrt_total_simulation),
+                                                  _mm256_cvtps_pd(_mm256_castps256_ps128(denominator)));
+        const __m256d value_u_high = _mm256_div_pd(_mm256_mul_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(biased_policy, 1)), sqrt_total_simulation),
+                                                   _mm256_cvtps_pd(_mm256_extractf128_ps(denominator, 1)));
+        _mm256_storeu_ps(&stats.value_u_[i], _mm256_set_m128(_mm256_cvtpd_ps(value_u_high), _mm256_cvtpd_ps(value_u_low)));
+
+        if (terms.constant_mean_) {
+            _mm256_storeu_ps(&stats.value_q_[i], one);
+            continue;
+        }
+        __m256 value = _mm256_add_ps(_mm256_loadu_ps(&stats.reward_[i]), _mm256_mul_ps(discount, _mm256_loadu_ps(&stats.mean_[i])));
+        if (terms.value_rescale_) {
+            value = _mm256_div_ps(_mm256_sub_ps(value, lower_bound), bound_range);
+            // max_ps returns its second operand for NaN, matching fmax(-1, NaN) == -1
+            value = _mm256_min_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_mul_ps(two, value), one), minus_one), one);
+        }
+        value = _mm256_mul_ps(value, _mm256_loadu_ps(&stats.sign_[i]));
+        _mm256_storeu_ps(&stats.value_q_[i], _mm256_div_ps(_mm256_sub_ps(_mm256_mul_ps(value, count), virtual_loss), count_with_virtual_loss));
+    }
+    computeScoresScalar(terms, stats, i);
+}
+
+inline bool supportAVX2()
+{
+    static const bool support_avx2 = (__builtin_cpu_init(), __builtin_cpu_supports("avx2"));
+    return support_avx2;
+}
+#endif
+
+} // namespace
+
+MCTSNode* MCTS::selectChildByPUCTScore(const MCTSNode* node) const
+{
+    assert(node && !node->isLeaf());
+    thread_local PUCTChildStats stats;
+    stats.gather(node);
+
+    const int total_simulation = node->getCountWithVirtualLoss() - 1;
+    PUCTParentTerms terms;
+    terms.puct_bias_ = MCTSNode::getPUCTBias(total_simulation);
+    terms.sqrt_total_simulation_ = sqrt(total_simulation);
+    terms.value_rescale_ = config::actor_mcts_value_rescale;
+    terms.constant_mean_ = false;
+    if (terms.value_rescale_) {
+        std::lock_guard<std::mutex> lock(tree_value_bound_mutex_);
+        terms.constant_mean_ = (tree_value_bound_.size() < 2);
+        if (!terms.constant_mean_) {
+            terms.value_lower_bound_ = tree_value_bound_.getLowerBound();
+            terms.value_bound_range_ = tree_value_bound_.getUpperBound() - terms.value_lower_bound_;
+        }
+    }
+
+#ifdef MCTS_PUCT_AVX2
+    if (supportAVX2()) {
+        computeScoresAVX2(terms, stats);
+    } else {
+        computeScoresScalar(terms, stats, 0);
+    }
+#else
+    computeScoresScalar(terms, stats, 0);
+#endif
+
+    // init Q value = avg Q value of all visited children + one loss
+    float sum_of_win = 0.0f, sum = 0.0f;
+    for (int i = 0; i < stats.size_; ++i) {
+        if (stats.count_with_virtual_loss_[i] == 0) { continue; }
+        sum_of_win += stats.value_q_[i];
+        sum += 1;
+    }
+#if ATARI
+    // explore more in Atari games (TODO: check if this method also performs better in board games)
+    const float init_q_value = (sum > 0 ? sum_of_win / sum : 1.0f);
+#else
+    const float init_q_value = (sum_of_win - 1) / (sum + 1);
+#endif
+
+    // proven children are not searched any more, unless all of them are proven (actor_mcts_solver)
+    int selected = -1;
+    float best_score = std::numeric_limits<float>::lowest(), best_policy = std::numeric_limits<float>::lowest();
+    for (int i = 0; i < stats.size_; ++i) {
+        if (stats.is_proven_[i] && stats.num_unproven_ > 0) { continue; }
+        float score = stats.value_u_[i] + (stats.count_with_virtual_loss_[i] == 0 ? init_q_value : stats.value_q_[i]);
+        if (score < best_score || (score == best_score && stats.policy_[i] <= best_policy)) { continue; }
+        best_score = score;
+        best_policy = stats.policy_[i];
+        selected = i;
+    }
+    assert(selected != -1);
+    return stats.getChild(selected);
+}
+
+} // namespace minizero::actor
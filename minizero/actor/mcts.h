@@ -2,143 +2,404 @@
 
 #include "configuration.h"
 #include "environment.h"
+#include "half.h"
+#include "hidden_state_slab.h"
 #include "random.h"
 #include "search.h"
 #include "tree.h"
 #include <algorithm>
+#include <cstdint>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
 #include <limits>
-#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace minizero::actor {
 
-class MCTSNode : public TreeNode {
+// multiset of the node values in the tree, tracking only its minimum and maximum
+// values are counted in an open-addressing hash table, and removed values are deleted lazily from two heaps,
+// so both bounds are always available in O(1)
+class TreeValueBound {
 public:
+    TreeValueBound() { clear(); }
+
+    inline void clear()
+    {
+        slots_.assign(kMinTableSize, Slot());
+        num_values_ = num_used_slots_ = 0;
+        min_heap_.clear();
+        max_heap_.clear();
+    }
+
+    inline void add(float value)
+    {
+        if (increaseCount(value) > 1) { return; }
+        min_heap_.push_back(value);
+        std::push_heap(min_heap_.begin(), min_heap_.end(), std::greater<float>());
+        max_heap_.push_back(value);
+        std::push_heap(max_heap_.begin(), max_heap_.end(), std::less<float>());
+    }
+
+    // remove one occurrence of the value, if present
+    inline void remove(float value)
+    {
+        if (decreaseCount(value) != 0) { return; }
+        if (min_heap_.size() > 2 * num_values_ + kMinHeapRebuildSize) {
+            rebuildHeaps();
+        } else {
+            popRemovedValues(min_heap_, std::greater<float>());
+            popRemovedValues(max_heap_, std::less<float>());
+        }
+    }
+
+    // number of distinct values
+    inline int size() const { return num_values_; }
+    inline float getLowerBound() const
+    {
+        assert(size() > 0);
+        return min_heap_.front();
+    }
+    inline float getUpperBound() const
+    {
+        assert(size() > 0);
+        return max_heap_.front();
+    }
+
+private:
+    class Slot {
+    public:
+        uint32_t key_ = 0;
+        int count_ = 0; // 0: empty, -1: removed
+    };
+
+    static const size_t kMinTableSize = 64;
+    static const size_t kMinHeapRebuildSize = 64;
+
+    static inline uint32_t getKey(float value)
+    {
+        uint32_t key;
+        value = (value == 0.0f ? 0.0f : value); // -0.0 and 0.0 are the same value
+        std::memcpy(&key, &value, sizeof(key));
+        return key;
+    }
+
+    inline size_t findSlot(uint32_t key) const
+    {
+        const size_t mask = slots_.size() - 1;
+        for (size_t index = (key * 2654435769u) & mask;; index = (index + 1) & mask) {
+            if (slots_[index].count_ == 0 || (slots_[index].count_ > 0 && slots_[index].key_ == key)) { return index; }
+        }
+    }
+
+    inline int getCount(float value) const { return std::max(slots_[findSlot(getKey(value))].count_, 0); }
+
+    inline int increaseCount(float value)
+    {
+        const uint32_t key = getKey(value);
+        const size_t mask = slots_.size() - 1;
+        size_t insert_index = slots_.size();
+        for (size_t index = (key * 2654435769u) & mask;; index = (index + 1) & mask) {
+            Slot& slot = slots_[index];
+            if (slot.count_ > 0 && slot.key_ == key) { return ++slot.count_; }
+            if (slot.count_ == -1 && insert_index == slots_.size()) { insert_index = index; }
+            if (slot.count_ == 0) {
+                if (insert_index == slots_.size()) {
+                    insert_index = index;
+                    ++num_used_slots_;
+                }
+                break;
+            }
+        }
+        slots_[insert_index].key_ = key;
+        slots_[insert_index].count_ = 1;
+        ++num_values_;
+        if (2 * num_used_slots_ > slots_.size()) { rehash(); }
+        return 1;
+    }
+
+    inline int decreaseCount(float value)
+    {
+        Slot& slot = slots_[findSlot(getKey(value))];
+        if (slot.count_ <= 0) { return -1; }
+        if (--slot.count_ > 0) { return slot.count_; }
+        slot.count_ = -1;
+        --num_values_;
+        return 0;
+    }
+
+    void rehash()
+    {
+        std::vector<Slot> old_slots;
+        old_slots.swap(slots_);
+        size_t size = kMinTableSize;
+        while (size < 4 * num_values_) { size *= 2; }
+        slots_.assign(size, Slot());
+        num_used_slots_ = num_values_;
+        for (const Slot& old_slot : old_slots) {
+            if (old_slot.count_ <= 0) { continue; }
+            size_t index = findSlot(old_slot.key_);
+            slots_[index] = old_slot;
+        }
+    }
+
+    template <class Compare>
+    inline void popRemovedValues(std::vector<float>& heap, Compare compare)
+    {
+        while (!heap.empty() && getCount(heap.front()) == 0) {
+            std::pop_heap(heap.begin(), heap.end(), compare);
+            heap.pop_back();
+        }
+    }
+
+    void rebuildHeaps()
+    {
+        min_heap_.clear();
+        for (const Slot& slot : slots_) {
+            if (slot.count_ <= 0) { continue; }
+            float value;
+            std::memcpy(&value, &slot.key_, sizeof(value));
+            min_heap_.push_back(value);
+        }
+        max_heap_ = min_heap_;
+        std::make_heap(min_heap_.begin(), min_heap_.end(), std::greater<float>());
+        std::make_heap(max_heap_.begin(), max_heap_.end(), std::less<float>());
+    }
+
+    size_t num_values_;
+    size_t num_used_slots_;
+    std::vector<Slot> slots_;
+    std::vector<float> min_heap_;
+    std::vector<float> max_heap_;
+};
+
+// replace the value by update(value) with a compare-and-swap loop, and return the old value
+// the statistics below are updated this way so that several threads can search the same tree (actor_mcts_think_num_threads)
+template <class T, class Update>
+inline T atomicUpdate(T& value, Update update)
+{
+    T old_value, new_value;
+    __atomic_load(&value, &old_value, __ATOMIC_RELAXED);
+    do {
+        new_value = update(old_value);
+    } while (!__atomic_compare_exchange(&value, &old_value, &new_value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    return old_value;
+}
+
+template <class T>
+inline T atomicLoad(const T& value)
+{
+    T loaded_value;
+    __atomic_load(&value, &loaded_value, __ATOMIC_RELAXED);
+    return loaded_value;
+}
+
+// mean and count are always updated together
+class MCTSNodeStatistics {
+public:
+    float mean_;
+    float count_;
+
+    inline MCTSNodeStatistics add(float value, float weight) const
+    {
+        MCTSNodeStatistics statistics = *this;
+        statistics.count_ += weight;
+        statistics.mean_ += weight * (value - statistics.mean_) / statistics.count_;
+        return statistics;
+    }
+
+    inline MCTSNodeStatistics remove(float value, float weight) const
+    {
+        MCTSNodeStatistics statistics = *this;
+        statistics.count_ -= weight;
+        statistics.mean_ -= weight * (value - statistics.mean_) / statistics.count_;
+        return statistics;
+    }
+};
+
+class MCTSNode : public TreeNode<MCTSNode> {
+public:
+    // the game-theoretic result of the node for the player of its action, proven by terminal leaves (actor_mcts_solver)
+    enum class Proof : uint16_t {
+        kUnknown,
+        kWin,
+        kLoss,
+        kDraw
+    };
+
     MCTSNode() { reset(); }
 
-    void reset() override
+    inline void reset()
     {
-        num_children_ = 0;
+        resetChildren();
         hidden_state_data_index_ = -1;
-        mean_ = 0.0f;
-        count_ = 0.0f;
+        statistics_.mean_ = 0.0f;
+        statistics_.count_ = 0.0f;
         virtual_loss_ = 0.0f;
         policy_ = 0.0f;
         policy_logit_ = 0.0f;
         policy_noise_ = 0.0f;
         value_ = 0.0f;
         reward_ = 0.0f;
-        first_child_ = nullptr;
+        setProof(Proof::kUnknown);
     }
 
-    virtual void add(float value, float weight = 1.0f)
+    // return the statistics before the update
+    inline MCTSNodeStatistics add(float value, float weight = 1.0f)
     {
-        if (count_ + weight <= 0) {
+        if (getCount() + weight <= 0) {
+            const MCTSNodeStatistics statistics = getStatistics();
             reset();
-        } else {
-            count_ += weight;
-            mean_ += weight * (value - mean_) / count_;
+            return statistics;
         }
+        return atomicUpdate(statistics_, [value, weight](const MCTSNodeStatistics& statistics) { return statistics.add(value, weight); });
     }
 
-    virtual void remove(float value, float weight = 1.0f)
+    inline void remove(float value, float weight = 1.0f)
     {
-        if (count_ + weight <= 0) {
+        if (getCount() + weight <= 0) {
             reset();
         } else {
-            count_ -= weight;
-            mean_ -= weight * (value - mean_) / count_;
+            atomicUpdate(statistics_, [value, weight](const MCTSNodeStatistics& statistics) { return statistics.remove(value, weight); });
         }
     }
 
-    virtual float getNormalizedMean(const std::map<float, int>& tree_value_bound) const
+    inline float getNormalizedMean(const TreeValueBound& tree_value_bound) const
     {
-        float value = reward_ + config::actor_mcts_reward_discount * mean_;
+        const MCTSNodeStatistics statistics = getStatistics();
+        float value = getReward() + config::actor_mcts_reward_discount * statistics.mean_;
         if (config::actor_mcts_value_rescale) {
             if (tree_value_bound.size() < 2) { return 1.0f; }
-            const float value_lower_bound = tree_value_bound.begin()->first;
-            const float value_upper_bound = tree_value_bound.rbegin()->first;
+            const float value_lower_bound = tree_value_bound.getLowerBound();
+            const float value_upper_bound = tree_value_bound.getUpperBound();
             value = (value - value_lower_bound) / (value_upper_bound - value_lower_bound);
             value = fmin(1, fmax(-1, 2 * value - 1)); // normalize to [-1, 1]
         }
-        value = (action_.getPlayer() == env::Player::kPlayer1 ? value : -value); // flip value according to player
-        value = (value * count_ - virtual_loss_) / getCountWithVirtualLoss();    // value with virtual loss
+        const float virtual_loss = getVirtualLoss();
+        value = (getPlayer() == env::Player::kPlayer1 ? value : -value);                         // flip value according to player
+        value = (value * statistics.count_ - virtual_loss) / (statistics.count_ + virtual_loss); // value with virtual loss
         return value;
     }
 
-    virtual float getNormalizedPUCTScore(int total_simulation, const std::map<float, int>& tree_value_bound, float init_q_value = -1.0f) const
+    inline float getNormalizedPUCTScore(int total_simulation, const TreeValueBound& tree_value_bound, float init_q_value = -1.0f) const
     {
-        float puct_bias = config::actor_mcts_puct_init + log((1 + total_simulation + config::actor_mcts_puct_base) / config::actor_mcts_puct_base);
+        float puct_bias = getPUCTBias(total_simulation);
         float value_u = (puct_bias * getPolicy() * sqrt(total_simulation)) / (1 + getCountWithVirtualLoss());
         float value_q = (getCountWithVirtualLoss() == 0 ? init_q_value : getNormalizedMean(tree_value_bound));
         return value_u + value_q;
     }
 
-    std::string toString() const override
+    static inline float getPUCTBias(int total_simulation) { return config::actor_mcts_puct_init + log((1 + total_simulation + config::actor_mcts_puct_base) / config::actor_mcts_puct_base); }
+
+    std::string toString() const
     {
         std::ostringstream oss;
         oss.precision(4);
-        oss << std::fixed << "p = " << policy_
-            << ", p_logit = " << policy_logit_
-            << ", p_noise = " << policy_noise_
-            << ", v = " << value_
-            << ", r = " << reward_
-            << ", mean = " << mean_
-            << ", count = " << count_;
+        oss << std::fixed << "p = " << getPolicy()
+            << ", p_logit = " << getPolicyLogit()
+            << ", p_noise = " << getPolicyNoise()
+            << ", v = " << getValue()
+            << ", r = " << getReward()
+            << ", mean = " << getMean()
+            << ", count = " << getCount();
+        if (isProven()) { oss << ", proof = " << (getProof() == Proof::kWin ? "win" : (getProof() == Proof::kLoss ? "loss" : "draw")); }
         return oss.str();
     }
 
-    bool displayInTreeLog() const override { return count_ > 0; }
+    inline bool displayInTreeLog() const { return getCount() > 0; }
 
     // setter
-    inline void setHiddenStateDataIndex(int hidden_state_data_index) { hidden_state_data_index_ = hidden_state_data_index; }
-    inline void setMean(float mean) { mean_ = mean; }
-    inline void setCount(float count) { count_ = count; }
-    inline void addVirtualLoss(float num = 1.0f) { virtual_loss_ += num; }
-    inline void removeVirtualLoss(float num = 1.0f) { virtual_loss_ -= num; }
+    inline void setHiddenStateDataIndex(int hidden_state_data_index)
+    {
+        // the index has 16 bits, which a tree with more hidden states or rest nodes would wrap
+        assert(hidden_state_data_index >= -1);
+        if (hidden_state_data_index >= static_cast<int>(std::numeric_limits<uint16_t>::max())) {
+            std::cerr << "hidden state index " << hidden_state_data_index << " exceeds the node limit " << std::numeric_limits<uint16_t>::max() - 1 << std::endl;
+            std::abort();
+        }
+        hidden_state_data_index_ = hidden_state_data_index;
+    }
+    inline void setMean(float mean) { statistics_.mean_ = mean; }
+    inline void setCount(float count) { statistics_.count_ = count; }
+    // return the virtual loss before the update
+    inline float addVirtualLoss(float num = 1.0f) { return atomicUpdate(virtual_loss_, [num](float virtual_loss) { return virtual_loss + num; }); }
+    inline float removeVirtualLoss(float num = 1.0f) { return atomicUpdate(virtual_loss_, [num](float virtual_loss) { return virtual_loss - num; }); }
     inline void setPolicy(float policy) { policy_ = policy; }
     inline void setPolicyLogit(float policy_logit) { policy_logit_ = policy_logit; }
     inline void setPolicyNoise(float policy_noise) { policy_noise_ = policy_noise; }
     inline void setValue(float value) { value_ = value; }
     inline void setReward(float reward) { reward_ = reward; }
-    inline void setFirstChild(MCTSNode* first_child) { TreeNode::setFirstChild(first_child); }
+    inline void setProof(Proof proof) { setProofBits(static_cast<int>(proof)); }
 
     // getter
-    inline int getHiddenStateDataIndex() const { return hidden_state_data_index_; }
-    inline float getMean() const { return mean_; }
-    inline float getCount() const { return count_; }
-    inline float getCountWithVirtualLoss() const { return count_ + virtual_loss_; }
-    inline float getVirtualLoss() const { return virtual_loss_; }
+    inline int getHiddenStateDataIndex() const { return (hidden_state_data_index_ == static_cast<uint16_t>(-1) ? -1 : hidden_state_data_index_); }
+    inline MCTSNodeStatistics getStatistics() const { return atomicLoad(statistics_); }
+    inline float getMean() const { return getStatistics().mean_; }
+    inline float getCount() const { return getStatistics().count_; }
+    inline float getCountWithVirtualLoss() const { return getCount() + getVirtualLoss(); }
+    inline float getVirtualLoss() const { return atomicLoad(virtual_loss_); }
     inline float getPolicy() const { return policy_; }
     inline float getPolicyLogit() const { return policy_logit_; }
     inline float getPolicyNoise() const { return policy_noise_; }
     inline float getValue() const { return value_; }
     inline float getReward() const { return reward_; }
-    inline virtual MCTSNode* getChild(int index) const override { return (index < num_children_ ? static_cast<MCTSNode*>(first_child_) + index : nullptr); }
+    inline Proof getProof() const { return static_cast<Proof>(getProofBits()); }
+    inline bool isProven() const { return getProof() != Proof::kUnknown; }
+    // the proof for another player of a two-player game
+    inline Proof getProof(env::Player player) const { return (getPlayer() == player ? getProof() : getOpponentProof(getProof())); }
+    static inline Proof getOpponentProof(Proof proof) { return (proof == Proof::kWin ? Proof::kLoss : (proof == Proof::kLoss ? Proof::kWin : proof)); }
+    // the proof of a terminal position for the player, where eval_score is for kPlayer1
+    static inline Proof getTerminalProof(float eval_score, env::Player player)
+    {
+        if (eval_score == 0) { return Proof::kDraw; }
+        return ((eval_score > 0) == (player == env::Player::kPlayer1) ? Proof::kWin : Proof::kLoss);
+    }
 
 protected:
-    int hidden_state_data_index_;
-    float mean_;
-    float count_;
+    // the statistics and the virtual loss updated by every backup are kept in full precision, the network outputs are stored as fp16
+    alignas(8) MCTSNodeStatistics statistics_;
     float virtual_loss_;
-    float policy_;
-    float policy_logit_;
-    float policy_noise_;
-    float value_;
-    float reward_;
+    utils::Half policy_;
+    utils::Half policy_logit_;
+    utils::Half policy_noise_;
+    utils::Half value_;
+    utils::Half reward_;
+    uint16_t hidden_state_data_index_;
 };
+static_assert(sizeof(MCTSNode) == 32, "MCTSNode should fit in half a cache line");
 
-class HiddenStateData {
+// statistics of a position shared by all nodes reaching it, used by actor_mcts_use_transposition
+class TranspositionEntry {
 public:
-    HiddenStateData(const std::vector<float>& hidden_state)
-        : hidden_state_(hidden_state) {}
-    std::vector<float> hidden_state_;
+    TranspositionEntry(MCTSNode* node)
+        : node_(node), statistics_({0.0f, 0.0f}) {}
+
+    // update the position with the value, and return the value to back up to the node reaching it
+    // the returned value lets the node mean catch up with the position mean, which also includes the visits through other nodes
+    // reference: Czech et al., Improving AlphaZero Using Monte-Carlo Graph Search, 2021
+    inline float getBackupValue(const MCTSNode* node, float value)
+    {
+        const MCTSNodeStatistics statistics = atomicUpdate(statistics_, [value](const MCTSNodeStatistics& statistics) { return statistics.add(value, 1.0f); }).add(value, 1.0f);
+        const MCTSNodeStatistics node_statistics = node->getStatistics();
+        if (statistics.count_ == node_statistics.count_ + 1) { return value; } // the position is only visited through this node
+        return fmin(1, fmax(-1, node_statistics.count_ * (statistics.mean_ - node_statistics.mean_) + statistics.mean_));
+    }
+
+    inline float getMean() const { return atomicLoad(statistics_).mean_; }
+
+    MCTSNode* node_; // the expanded node whose children are shared
+
+private:
+    alignas(8) MCTSNodeStatistics statistics_;
 };
-typedef TreeData<HiddenStateData> TreeHiddenStateData;
 
-class MCTS : public Tree, public Search {
+class MCTS : public Tree<MCTSNode>, public Search {
 public:
     class ActionCandidate {
     public:
@@ -149,14 +410,26 @@ public:
             : action_(action), policy_(policy), policy_logit_(policy_logit) {}
     };
 
-    MCTS(uint64_t tree_node_size)
-        : Tree(tree_node_size) {}
+    // the action candidates not yet allocated as children, kept by the rest node of a lazily expanded node
+    class RestData {
+    public:
+        RestData(std::vector<ActionCandidate>::const_iterator begin, std::vector<ActionCandidate>::const_iterator end)
+            : action_candidates_(begin, end) {}
+        std::vector<ActionCandidate> action_candidates_;
+    };
+    typedef TreeData<RestData> TreeRestData;
+
+    MCTS(uint64_t tree_node_size, std::shared_ptr<TreeNodePool> tree_node_pool = nullptr)
+        : Tree<MCTSNode>(tree_node_size, tree_node_pool),
+          tree_hidden_state_data_(HiddenStateSlab::toPrecision(config::actor_mcts_hidden_state_precision)) {}
 
     void reset() override
     {
         Tree::reset();
         tree_hidden_state_data_.reset();
+        tree_rest_data_.reset();
         tree_value_bound_.clear();
+        transposition_table_.clear();
     }
 
     virtual bool isResign(const MCTSNode* selected_node) const
@@ -172,8 +445,7 @@ public:
         assert(node && !node->isLeaf());
         float max_count = 0.0f;
         MCTSNode* selected = nullptr;
-        for (int i = 0; i < node->getNumChildren(); ++i) {
-            MCTSNode* child = node->getChild(i);
+        for (MCTSNode* child : node->getChildren()) {
             if (child->getCount() <= max_count) { continue; }
             max_count = child->getCount();
             selected = child;
@@ -189,8 +461,7 @@ public:
         MCTSNode* best_child = selectChildByMaxCount(node);
         float best_mean = best_child->getNormalizedMean(tree_value_bound_);
         float sum = 0.0f;
-        for (int i = 0; i < node->getNumChildren(); ++i) {
-            MCTSNode* child = node->getChild(i);
+        for (MCTSNode* child : node->getChildren()) {
             float count = std::pow(child->getCount(), 1 / temperature);
             float mean = child->getNormalizedMean(tree_value_bound_);
             if (count == 0 || (mean < best_mean - value_threshold)) { continue; }
@@ -202,12 +473,23 @@ public:
         return selected;
     }
 
+    // the most visited child with the proof for the player to move, nullptr if none
+    virtual MCTSNode* selectChildByProof(const MCTSNode* node, MCTSNode::Proof proof) const
+    {
+        assert(node && !node->isLeaf());
+        MCTSNode* selected = nullptr;
+        for (MCTSNode* child : node->getChildren()) {
+            if (child->getProof() != proof || (selected && child->getCount() <= selected->getCount())) { continue; }
+            selected = child;
+        }
+        return selected;
+    }
+
     virtual std::string getSearchDistributionString() const
     {
         const MCTSNode* root = getRootNode();
         std::ostringstream oss;
-        for (int i = 0; i < root->getNumChildren(); ++i) {
-            MCTSNode* child = root->getChild(i);
+        for (MCTSNode* child : root->getChildren()) {
             if (child->getCount() == 0) { continue; }
             oss << (oss.str().empty() ? "" : ",")
                 << child->getAction().getActionID() << ":" << child->getCount();
@@ -229,101 +511,222 @@ public:
         return node_path;
     }
 
-    virtual void expand(MCTSNode* leaf_node, const std::vector<ActionCandidate>& action_candidates)
+    // the children are published to other search threads only after they are initialized
+    // a lazy expansion only allocates the first actor_mcts_expand_top_k candidates, which should be sorted by policy,
+    // and keeps the rest in a rest node, see widen()
+    // return false if another thread claimed the children first, whose children may not be published yet
+    virtual bool expand(MCTSNode* leaf_node, const std::vector<ActionCandidate>& action_candidates, bool lazy_expansion = false)
     {
         assert(leaf_node && action_candidates.size() > 0);
-        leaf_node->setFirstChild(allocateNodes(action_candidates.size()));
-        leaf_node->setNumChildren(action_candidates.size());
-        for (size_t i = 0; i < action_candidates.size(); ++i) {
-            const auto& candidate = action_candidates[i];
-            MCTSNode* child = leaf_node->getChild(i);
-            child->reset();
-            child->setAction(candidate.action_);
-            child->setPolicy(candidate.policy_);
-            child->setPolicyLogit(candidate.policy_logit_);
+        if (!leaf_node->claimChildren()) { return false; }
+        if (!lazy_expansion || config::actor_mcts_expand_top_k <= 0) {
+            setChildren(leaf_node, action_candidates.begin(), action_candidates.end(), action_candidates.size());
+            return true;
         }
+        // all candidates are kept, since the node may become the root of a reused tree, which is widened to all of them
+        setChildren(leaf_node, action_candidates.begin(), action_candidates.end(), config::actor_mcts_expand_top_k);
+        return true;
     }
 
-    virtual void backup(const std::vector<MCTSNode*>& node_path, const float value, const float reward = 0.0f)
+    // allocate the next actor_mcts_expand_top_k candidates of the rest node of the node, or all of them if widen_all is true
+    // return false if the node has no rest candidates, or another thread is widening it
+    virtual bool widen(MCTSNode* node, bool widen_all = false)
     {
-        assert(node_path.size() > 0);
+        int num_children = 0;
+        MCTSNode* rest_node = findRestNode(node, num_children);
+        if (!rest_node || !rest_node->claimChildren()) { return false; }
+        const RestData rest_data = tree_rest_data_.loadData(rest_node->getHiddenStateDataIndex());
+        const std::vector<ActionCandidate>& action_candidates = rest_data.action_candidates_;
+        setChildren(rest_node, action_candidates.begin(), action_candidates.end(), (widen_all ? action_candidates.size() : config::actor_mcts_expand_top_k));
+        return true;
+    }
+
+    // transpositions, if given, are the entries of the positions of node_path (nullptr for no entry)
+    // with actor_mcts_expand_top_k, the node closest to the root whose visits call for more children is widened,
+    // at most one per backup so that the tree grows by at most two blocks of children per simulation
+    virtual void backup(const std::vector<MCTSNode*>& node_path, const float value, const float reward = 0.0f, const std::vector<TranspositionEntry*>& transpositions = {})
+    {
+        assert(node_path.size() > 0 && (transpositions.empty() || transpositions.size() == node_path.size()));
         float updated_value = value;
         node_path.back()->setValue(value);
         node_path.back()->setReward(reward);
         for (int i = static_cast<int>(node_path.size() - 1); i >= 0; --i) {
             MCTSNode* node = node_path[i];
-            float old_mean = node->getReward() + config::actor_mcts_reward_discount * node->getMean();
-            node->add(updated_value);
-            updateTreeValueBound(old_mean, node->getReward() + config::actor_mcts_reward_discount * node->getMean());
+            if (!transpositions.empty() && transpositions[i]) { updated_value = transpositions[i]->getBackupValue(node, updated_value); }
+            const MCTSNodeStatistics old_statistics = node->add(updated_value);
+            if (config::actor_mcts_value_rescale) {
+                updateTreeValueBound(node->getReward() + config::actor_mcts_reward_discount * old_statistics.mean_,
+                                     node->getReward() + config::actor_mcts_reward_discount * old_statistics.add(updated_value, 1.0f).mean_);
+            }
             updated_value = node->getReward() + config::actor_mcts_reward_discount * updated_value;
         }
+        if (config::actor_mcts_expand_top_k <= 0) { return; }
+        for (MCTSNode* node : node_path) {
+            int num_children = 0;
+            if (node->isLeaf() || !findRestNode(node, num_children) || num_children >= getNumWidenedChildren(node->getCount())) { continue; }
+            if (widen(node)) { break; }
+        }
+    }
+
+    // MCTS-solver: prove the nodes of the path upward from its proven leaf, until a node cannot be proven
+    // a node is won by the player to move if any child is won, and is lost or drawn only if all children are proven,
+    // which is only known without actor_mcts_expand_top_k, as lazily expanded nodes may not have all legal actions as children
+    // reference: Winands et al., Monte-Carlo Tree Search Solver, 2008
+    virtual void proveNodePath(const std::vector<MCTSNode*>& node_path)
+    {
+        assert(node_path.size() > 0 && node_path.back()->isProven());
+        for (int i = static_cast<int>(node_path.size()) - 2; i >= 0; --i) {
+            if (!proveNode(node_path[i])) { break; }
+        }
+    }
+
+    // reuse the subtree of the node as the next search tree, along with its hidden states, rest candidates and value bound
+    template <class Predicate>
+    void moveSubtreeToRoot(MCTSNode* new_root, Predicate keep_root_child)
+    {
+        std::vector<int> hidden_state_data_indices;
+        std::vector<int> rest_data_indices;
+        tree_value_bound_.clear();
+        Tree::moveSubtreeToRoot(new_root, keep_root_child, [&](MCTSNode* node) {
+            if (node->isRest()) {
+                // the candidates of a widened rest node are all allocated
+                if (node->isLeaf()) {
+                    rest_data_indices.push_back(node->getHiddenStateDataIndex());
+                    node->setHiddenStateDataIndex(rest_data_indices.size() - 1);
+                } else {
+                    node->setHiddenStateDataIndex(-1);
+                }
+            } else if (node->getHiddenStateDataIndex() != -1) {
+                hidden_state_data_indices.push_back(node->getHiddenStateDataIndex());
+                node->setHiddenStateDataIndex(hidden_state_data_indices.size() - 1);
+            }
+            if (config::actor_mcts_value_rescale && node->getCount() > 0) { tree_value_bound_.add(node->getReward() + config::actor_mcts_reward_discount * node->getMean()); }
+        });
+        tree_hidden_state_data_.keep(hidden_state_data_indices);
+        tree_rest_data_.keep(rest_data_indices);
+        transposition_table_.clear();
+    }
+
+    inline TranspositionEntry* findTransposition(uint64_t key)
+    {
+        std::lock_guard<std::mutex> lock(transposition_mutex_);
+        auto it = transposition_table_.find(key);
+        return (it == transposition_table_.end() ? nullptr : &it->second);
+    }
+
+    std::vector<TranspositionEntry*> findTranspositions(const std::vector<uint64_t>& keys)
+    {
+        std::vector<TranspositionEntry*> transpositions;
+        transpositions.reserve(keys.size());
+        for (uint64_t key : keys) { transpositions.push_back(findTransposition(key)); }
+        return transpositions;
+    }
+
+    // return the existing entry if the position is already added
+    inline TranspositionEntry* addTransposition(uint64_t key, MCTSNode* node)
+    {
+        std::lock_guard<std::mutex> lock(transposition_mutex_);
+        return &transposition_table_.emplace(key, TranspositionEntry(node)).first->second;
+    }
+
+    // let the leaf node share the children of an expanded node of the same position, so the tree becomes a directed acyclic graph
+    inline void shareChildren(MCTSNode* leaf_node, const MCTSNode* node)
+    {
+        assert(leaf_node && node && !node->isLeaf());
+        if (!leaf_node->claimChildren()) { return; }
+        leaf_node->publishChildren(node->getChild(0), node->getNumChildren());
     }
 
-    inline MCTSNode* allocateNodes(int size) { return static_cast<MCTSNode*>(Tree::allocateNodes(size)); }
     inline int getNumSimulation() const { return getRootNode()->getCount(); }
-    inline bool reachMaximumSimulation() const { return (getNumSimulation() == config::actor_num_simulation + 1); }
-    inline MCTSNode* getRootNode() { return static_cast<MCTSNode*>(Tree::getRootNode()); }
-    inline const MCTSNode* getRootNode() const { return static_cast<const MCTSNode*>(Tree::getRootNode()); }
-    inline TreeHiddenStateData& getTreeHiddenStateData() { return tree_hidden_state_data_; }
-    inline const TreeHiddenStateData& getTreeHiddenStateData() const { return tree_hidden_state_data_; }
-    inline std::map<float, int>& getTreeValueBound() { return tree_value_bound_; }
-    inline const std::map<float, int>& getTreeValueBound() const { return tree_value_bound_; }
+    inline bool reachMaximumSimulation(int num_simulation = config::actor_num_simulation) const { return (getNumSimulation() >= num_simulation + 1); }
+    inline HiddenStateSlab& getTreeHiddenStateData() { return tree_hidden_state_data_; }
+    inline const HiddenStateSlab& getTreeHiddenStateData() const { return tree_hidden_state_data_; }
+    inline TreeValueBound& getTreeValueBound() { return tree_value_bound_; }
+    inline const TreeValueBound& getTreeValueBound() const { return tree_value_bound_; }
 
 protected:
-    TreeNode* createTreeNodes(uint64_t tree_node_size) override { return new MCTSNode[tree_node_size]; }
-    TreeNode* getNodeIndex(int index) override { return getRootNode() + index; }
+    // single pass over the children, see mcts.cpp
+    virtual MCTSNode* selectChildByPUCTScore(const MCTSNode* node) const;
 
-    virtual MCTSNode* selectChildByPUCTScore(const MCTSNode* node) const
+    // return false if the node cannot be proven by its children
+    virtual bool proveNode(MCTSNode* node)
     {
-        assert(node && !node->isLeaf());
-        MCTSNode* selected = nullptr;
-        int total_simulation = node->getCountWithVirtualLoss() - 1;
-        float init_q_value = calculateInitQValue(node);
-        float best_score = std::numeric_limits<float>::lowest(), best_policy = std::numeric_limits<float>::lowest();
-        for (int i = 0; i < node->getNumChildren(); ++i) {
-            MCTSNode* child = node->getChild(i);
-            float score = child->getNormalizedPUCTScore(total_simulation, tree_value_bound_, init_q_value);
-            if (score < best_score || (score == best_score && child->getPolicy() <= best_policy)) { continue; }
-            best_score = score;
-            best_policy = child->getPolicy();
-            selected = child;
+        if (node->isLeaf()) { return node->isProven(); }
+        const std::vector<MCTSNode*> children = node->getChildren();
+        const env::Player player = children[0]->getAction().getPlayer(); // the player to move
+        bool is_all_proven = (config::actor_mcts_expand_top_k <= 0);
+        bool has_draw = false;
+        for (const MCTSNode* child : children) {
+            const MCTSNode::Proof proof = child->getProof(player);
+            if (proof == MCTSNode::Proof::kWin) {
+                setProof(node, MCTSNode::Proof::kWin, player);
+                return true;
+            }
+            is_all_proven = (is_all_proven && proof != MCTSNode::Proof::kUnknown);
+            has_draw = (has_draw || proof == MCTSNode::Proof::kDraw);
         }
-        assert(selected != nullptr);
-        return selected;
+        if (!is_all_proven) { return false; }
+        setProof(node, (has_draw ? MCTSNode::Proof::kDraw : MCTSNode::Proof::kLoss), player);
+        return true;
     }
 
-    virtual float calculateInitQValue(const MCTSNode* node) const
+    // set the proof of the node, given for the player
+    static inline void setProof(MCTSNode* node, MCTSNode::Proof proof, env::Player player) { node->setProof(node->getAction().getPlayer() == player ? proof : MCTSNode::getOpponentProof(proof)); }
+
+    // allocate the children for the candidates, at most num_allocated_candidates of them followed by a rest node keeping the others
+    void setChildren(MCTSNode* node, std::vector<ActionCandidate>::const_iterator begin, std::vector<ActionCandidate>::const_iterator end, int num_allocated_candidates)
     {
-        // init Q value = avg Q value of all visited children + one loss
-        assert(node && !node->isLeaf());
-        float sum_of_win = 0.0f, sum = 0.0f;
-        for (int i = 0; i < node->getNumChildren(); ++i) {
-            MCTSNode* child = node->getChild(i);
-            if (child->getCountWithVirtualLoss() == 0) { continue; }
-            sum_of_win += child->getNormalizedMean(tree_value_bound_);
-            sum += 1;
+        const int num_candidates = std::min<int>(end - begin, num_allocated_candidates);
+        const bool has_rest = (begin + num_candidates != end);
+        MCTSNode* first_child = allocateNodes(num_candidates + (has_rest ? 1 : 0));
+        for (int i = 0; i < num_candidates; ++i) {
+            const auto& candidate = *(begin + i);
+            MCTSNode* child = first_child + i;
+            child->reset();
+            child->setAction(candidate.action_);
+            child->setPolicy(candidate.policy_);
+            child->setPolicyLogit(candidate.policy_logit_);
+        }
+        if (has_rest) {
+            MCTSNode* rest_node = first_child + num_candidates;
+            rest_node->reset();
+            rest_node->setAction(Action(MCTSNode::kRestActionID, begin->action_.getPlayer()));
+            rest_node->setHiddenStateDataIndex(tree_rest_data_.store(RestData(begin + num_candidates, end)));
+        }
+        node->publishChildren(first_child, num_candidates + (has_rest ? 1 : 0));
+    }
+
+    // return the rest node that is not widened yet, and count the allocated children of the node
+    MCTSNode* findRestNode(const MCTSNode* node, int& num_children) const
+    {
+        num_children = 0;
+        for (const MCTSNode* block = node; !block->isLeaf();) {
+            const MCTSNode* last_child = block->getChild(block->getNumChildren() - 1);
+            num_children += block->getNumChildren() - (last_child->isRest() ? 1 : 0);
+            if (!last_child->isRest()) { return nullptr; }
+            if (last_child->isLeaf()) { return const_cast<MCTSNode*>(last_child); }
+            block = last_child;
         }
-#if ATARI
-        // explore more in Atari games (TODO: check if this method also performs better in board games)
-        return (sum > 0 ? sum_of_win / sum : 1.0f);
-#else
-        return (sum_of_win - 1) / (sum + 1);
-#endif
+        return nullptr;
     }
 
+    // progressive widening: a node visited count times has ceil(C * count^alpha) children, in blocks of actor_mcts_expand_top_k
+    static inline int getNumWidenedChildren(float count) { return std::ceil(config::actor_mcts_widening_factor * std::pow(count, config::actor_mcts_widening_exponent)); }
+
     virtual void updateTreeValueBound(float old_value, float new_value)
     {
         if (!config::actor_mcts_value_rescale) { return; }
-        if (tree_value_bound_.count(old_value)) {
-            assert(tree_value_bound_[old_value] > 0);
-            --tree_value_bound_[old_value];
-            if (tree_value_bound_[old_value] == 0) { tree_value_bound_.erase(old_value); }
-        }
-        ++tree_value_bound_[new_value];
+        std::lock_guard<std::mutex> lock(tree_value_bound_mutex_);
+        tree_value_bound_.remove(old_value);
+        tree_value_bound_.add(new_value);
     }
 
-    std::map<float, int> tree_value_bound_;
-    TreeHiddenStateData tree_hidden_state_data_;
+    TreeValueBound tree_value_bound_;
+    HiddenStateSlab tree_hidden_state_data_;
+    TreeRestData tree_rest_data_;
+    std::unordered_map<uint64_t, TranspositionEntry> transposition_table_;
+    mutable std::mutex tree_value_bound_mutex_;
+    std::mutex transposition_mutex_;
 };
 
 } // namespace minizero::actor
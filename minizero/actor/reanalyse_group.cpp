@@ -0,0 +1,161 @@
+#include "reanalyse_group.h"
+#include "configuration.h"
+#include "random.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace minizero::actor {
+
+using namespace utils;
+
+void ReanalyseSharedData::indexGames(int start_iteration, int end_iteration)
+{
+    // the files are only read once, the records are read again when sampled
+    for (auto it = game_offsets_.begin(); it != game_offsets_.end();) { it = (it->first < start_iteration || it->first > end_iteration ? game_offsets_.erase(it) : std::next(it)); }
+    for (int iteration = start_iteration; iteration <= end_iteration; ++iteration) {
+        if (game_offsets_.count(iteration)) { continue; }
+        std::ifstream fin(config::zero_training_directory + "/sgf/" + std::to_string(iteration) + ".sgf", std::ifstream::in);
+        if (!fin.is_open()) { continue; }
+        std::vector<std::streampos>& offsets = game_offsets_[iteration];
+        std::string content;
+        for (std::streampos offset = fin.tellg(); std::getline(fin, content); offset = fin.tellg()) { offsets.push_back(offset); }
+    }
+
+    games_.clear();
+    for (const auto& iteration_offsets : game_offsets_) {
+        for (const std::streampos& offset : iteration_offsets.second) { games_.push_back({iteration_offsets.first, offset}); }
+    }
+}
+
+std::shared_ptr<ReanalyseGame> ReanalyseSharedData::sampleGame()
+{
+    if (games_.empty()) { return nullptr; }
+
+    // format: game_record [#], where # marks a terminal game
+    const std::pair<int, std::streampos>& game = games_[Random::randInt() % games_.size()];
+    std::ifstream fin(config::zero_training_directory + "/sgf/" + std::to_string(game.first) + ".sgf", std::ifstream::in);
+    std::string content;
+    if (!fin.seekg(game.second) || !std::getline(fin, content)) { return nullptr; }
+
+    std::shared_ptr<ReanalyseGame> reanalyse_game = std::make_shared<ReanalyseGame>();
+    reanalyse_game->is_terminal_ = (content.size() >= 2 && content.substr(content.size() - 2) == " #");
+    if (reanalyse_game->is_terminal_) { content.resize(content.size() - 2); }
+    if (!reanalyse_game->env_loader_.loadFromString(content)) { return nullptr; }
+    if (reanalyse_game->env_loader_.getDataRange().first >= static_cast<int>(reanalyse_game->env_loader_.getActionPairs().size())) { return nullptr; }
+    return reanalyse_game;
+}
+
+void ReanalyseSharedData::outputGame(const ReanalyseGame& game)
+{
+    const EnvironmentLoader& env_loader = game.env_loader_;
+    std::pair<int, int> data_range = env_loader.getDataRange();
+
+    std::ostringstream oss;
+    oss << "Reanalyse "
+        << (game.is_terminal_ ? "true" : "false") << " "    // is terminal
+        << (data_range.second - data_range.first + 1) << " " // data length
+        << env_loader.getActionPairs().size() << " "        // game length
+        << env_loader.getTag("RE") << " "                   // return
+        << env_loader.toString() << " "                     // game record
+        << "#";                                             // end mark for a valid game
+
+    std::lock_guard lock(mutex_);
+    std::cout << oss.str() << std::endl;
+}
+
+bool ReanalyseSlaveThread::doCPUJob()
+{
+    size_t actor_id = getSharedData()->getAvailableActorIndex(numa_node_);
+    if (actor_id >= getSharedData()->actors_.size()) { return false; }
+
+    std::shared_ptr<BaseActor>& actor = getSharedData()->actors_[actor_id];
+    if (actor->getNNEvaluationBatchIndex() >= 0) {
+        actor->afterNNEvaluation(getNNEvaluationOutput(actor_id));
+        if (actor->isSearchDone()) { handleSearchDone(actor_id); }
+    }
+
+    // an idle actor samples the next game
+    while (getSharedData()->actor_games_[actor_id] || startGame(actor_id)) {
+        actor->beforeNNEvaluation();
+        if (actor->getNNEvaluationBatchIndex() >= 0) { break; }
+        handleSearchDone(actor_id);
+    }
+    return true;
+}
+
+void ReanalyseSlaveThread::handleSearchDone(int actor_id)
+{
+    assert(actor_id >= 0 && actor_id < static_cast<int>(getSharedData()->actors_.size()) && getSharedData()->actor_games_[actor_id]);
+
+    // play the recorded action, and replace the action info of the position by the search
+    std::shared_ptr<BaseActor>& actor = getSharedData()->actors_[actor_id];
+    std::shared_ptr<ReanalyseGame>& game = getSharedData()->actor_games_[actor_id];
+    std::vector<std::pair<Action, EnvironmentLoader::ActionInfo>>& action_pairs = game->env_loader_.getActionPairs();
+    const int pos = actor->getEnvironment().getActionHistory().size();
+    if (!actor->act(action_pairs[pos].first)) {
+        game = nullptr;
+        actor->reset();
+        return;
+    }
+    for (const auto& info : actor->getActionInfoHistory().back()) {
+        if (info.first == "P" || info.first == "V") { action_pairs[pos].second[info.first] = info.second; }
+    }
+    action_pairs[pos].second.erase("F"); // a full search of a fast search position of playout cap randomization
+
+    // the positions after the data range are not training data either, so the game is done at the end of the range
+    if (pos + 1 <= game->env_loader_.getDataRange().second && pos + 1 < static_cast<int>(action_pairs.size())) {
+        actor->resetSearch();
+    } else {
+        game->env_loader_.addTag("RA", config::nn_file_name.substr(config::nn_file_name.find_last_of('/') + 1));
+        getSharedData()->outputGame(*game);
+        game = nullptr;
+        actor->reset();
+    }
+}
+
+bool ReanalyseSlaveThread::startGame(int actor_id)
+{
+    std::shared_ptr<ReanalyseGame> game = getSharedData()->sampleGame();
+    if (!game) { return false; }
+
+    // the positions before the data range are not training data, so they are played without search
+    std::shared_ptr<BaseActor>& actor = getSharedData()->actors_[actor_id];
+    const std::vector<std::pair<Action, EnvironmentLoader::ActionInfo>>& action_pairs = game->env_loader_.getActionPairs();
+    actor->reset();
+    game->env_loader_.resetEnvironment(actor->getEnvironment());
+    for (int pos = 0; pos < game->env_loader_.getDataRange().first; ++pos) {
+        if (!actor->act(action_pairs[pos].first)) { return false; }
+    }
+    actor->resetSearch();
+    getSharedData()->actor_games_[actor_id] = game;
+    return true;
+}
+
+void ReanalyseGroup::initialize()
+{
+    ActorGroup::initialize();
+    getSharedData()->actor_games_.resize(getSharedData()->actors_.size());
+    config::actor_playout_cap_fast_ratio = 0.0f; // every position is a policy target
+}
+
+void ReanalyseGroup::handleCommand(const std::string& command_prefix, const std::string& command)
+{
+    if (command_prefix == "reanalyse") {
+        std::cerr << "[command] " << command << std::endl;
+        std::vector<std::string> args = utils::stringToVector(command);
+        assert(args.size() == 3);
+        getSharedData()->indexGames(std::stoi(args[1]), std::stoi(args[2]));
+        std::cerr << "[reanalyse] " << getSharedData()->games_.size() << " games" << std::endl;
+    } else {
+        if (command_prefix == "reset_actors") { std::fill(getSharedData()->actor_games_.begin(), getSharedData()->actor_games_.end(), nullptr); }
+        ActorGroup::handleCommand(command_prefix, command);
+    }
+}
+
+} // namespace minizero::actor
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "actor_group.h"
+#include "environment.h"
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace minizero::actor {
+
+class ReanalyseGame {
+public:
+    bool is_terminal_;
+    EnvironmentLoader env_loader_;
+};
+
+class ReanalyseSharedData : public ThreadSharedData {
+public:
+    void indexGames(int start_iteration, int end_iteration);
+    std::shared_ptr<ReanalyseGame> sampleGame();
+    void outputGame(const ReanalyseGame& game);
+
+    std::map<int, std::vector<std::streampos>> game_offsets_; // the offsets of the game records in the file of each iteration
+    std::vector<std::pair<int, std::streampos>> games_;        // the games sampled from, by iteration and offset
+    std::vector<std::shared_ptr<ReanalyseGame>> actor_games_;   // the game reanalysed by each actor, nullptr for an idle actor
+};
+
+class ReanalyseSlaveThread : public SlaveThread {
+public:
+    ReanalyseSlaveThread(int id, std::shared_ptr<utils::BaseSharedData> shared_data)
+        : SlaveThread(id, shared_data) {}
+
+protected:
+    bool doCPUJob() override;
+    void handleSearchDone(int actor_id) override;
+    virtual bool startGame(int actor_id);
+    inline std::shared_ptr<ReanalyseSharedData> getSharedData() { return std::static_pointer_cast<ReanalyseSharedData>(shared_data_); }
+};
+
+// MuZero Reanalyse: each actor replays a game sampled from the self-play records of recent iterations, searching every position
+// from the start of its data range with the current model, and writes the game with the new P/V action info as "Reanalyse" to std::cout
+// the games are sampled from the iterations of the last "reanalyse <start_iteration> <end_iteration>" command
+// reference: Schrittwieser et al., Mastering Atari, Go, chess and shogi by planning with a learned model, Appendix H
+class ReanalyseGroup : public ActorGroup {
+public:
+    ReanalyseGroup() {}
+
+    void initialize() override;
+
+protected:
+    void handleCommand(const std::string& command_prefix, const std::string& command) override;
+
+    void createSharedData() override { shared_data_ = std::make_shared<ReanalyseSharedData>(); }
+    std::shared_ptr<utils::BaseSlaveThread> newSlaveThread(int id) override { return std::make_shared<ReanalyseSlaveThread>(id, shared_data_); }
+    inline std::shared_ptr<ReanalyseSharedData> getSharedData() { return std::static_pointer_cast<ReanalyseSharedData>(shared_data_); }
+};
+
+} // namespace minizero::actor
@@ -0,0 +1,70 @@
+#include "search_paralleler.h"
+#include "configuration.h"
+#include "random.h"
+#include "zero_actor.h"
+#include <random>
+
+namespace minizero::actor {
+
+using namespace utils;
+
+void SearchSlaveThread::initialize()
+{
+    int seed = config::program_auto_seed ? std::random_device()() : config::program_seed + id_;
+    Random::seed(seed);
+}
+
+void SearchSlaveThread::runJob()
+{
+    std::shared_ptr<SearchSharedData> shared_data = getSharedData();
+    std::vector<MCTSSimulation>& simulations = shared_data->simulations_[id_];
+    if (shared_data->phase_ == SearchSharedData::Phase::kSelection) {
+        simulations.resize(shared_data->num_simulations_[id_]);
+        for (auto& simulation : simulations) { shared_data->actor_->selectSimulation(simulation, id_); }
+    } else {
+        for (auto& simulation : simulations) {
+            shared_data->actor_->backupSimulation(simulation, (simulation.nn_evaluation_batch_id_ == -1 ? nullptr : shared_data->network_outputs_[simulation.nn_evaluation_batch_id_]));
+        }
+        simulations.clear();
+    }
+}
+
+SearchParalleler::SearchParalleler(ZeroActor* actor, int num_threads)
+{
+    assert(actor && num_threads > 0);
+    createSlaveThreads(num_threads);
+    getSharedData()->actor_ = actor;
+    getSharedData()->num_simulations_.resize(num_threads);
+    getSharedData()->simulations_.resize(num_threads);
+}
+
+void SearchParalleler::selectSimulations(int num_simulations)
+{
+    std::shared_ptr<SearchSharedData> shared_data = getSharedData();
+    const int num_threads = slave_threads_.size();
+    for (int id = 0; id < num_threads; ++id) { shared_data->num_simulations_[id] = num_simulations / num_threads + (id < num_simulations % num_threads ? 1 : 0); }
+    shared_data->phase_ = SearchSharedData::Phase::kSelection;
+    run();
+}
+
+void SearchParalleler::backupSimulations(const std::vector<std::shared_ptr<network::NetworkOutput>>& network_outputs)
+{
+    std::shared_ptr<SearchSharedData> shared_data = getSharedData();
+    shared_data->network_outputs_ = network_outputs;
+    shared_data->phase_ = SearchSharedData::Phase::kBackup;
+    run();
+    shared_data->network_outputs_.clear();
+}
+
+int SearchParalleler::getNumNetworkEvaluations()
+{
+    int num_evaluations = 0;
+    for (const auto& simulations : getSharedData()->simulations_) {
+        for (const auto& simulation : simulations) {
+            if (simulation.nn_evaluation_batch_id_ != -1) { ++num_evaluations; }
+        }
+    }
+    return num_evaluations;
+}
+
+} // namespace minizero::actor
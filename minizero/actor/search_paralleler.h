@@ -0,0 +1,75 @@
+#pragma once
+
+#include "mcts.h"
+#include "network.h"
+#include "paralleler.h"
+#include "rotation.h"
+#include <memory>
+#include <vector>
+
+namespace minizero::actor {
+
+class ZeroActor;
+
+// a simulation from the selection to the backup
+class MCTSSimulation {
+public:
+    int nn_evaluation_batch_id_; // -1 if the leaf is not evaluated by the network
+    utils::Rotation feature_rotation_;
+    std::vector<MCTSNode*> node_path_;
+
+    // the leaf position, kept when the node path is played so that the backup needs no environment (AlphaZero only)
+    // terminal leaves are backed up when played, and never evaluated by the network
+    float reward_;
+    std::vector<Action> legal_actions_;
+    std::vector<uint64_t> position_keys_;                   // only if the transposition is used
+    uint64_t evaluation_key_;                               // only if the evaluation cache is used
+    std::shared_ptr<network::NetworkOutput> cached_output_; // found in the evaluation cache, backed up without the network
+};
+
+class SearchSharedData : public utils::BaseSharedData {
+public:
+    enum class Phase {
+        kSelection,
+        kBackup
+    };
+
+    ZeroActor* actor_;
+    Phase phase_;
+    std::vector<int> num_simulations_;
+    std::vector<std::vector<MCTSSimulation>> simulations_;
+    std::vector<std::shared_ptr<network::NetworkOutput>> network_outputs_;
+};
+
+class SearchSlaveThread : public utils::BaseSlaveThread {
+public:
+    SearchSlaveThread(int id, std::shared_ptr<utils::BaseSharedData> shared_data)
+        : BaseSlaveThread(id, shared_data) {}
+
+    void initialize() override;
+    void runJob() override;
+    bool isDone() override { return false; }
+
+protected:
+    inline std::shared_ptr<SearchSharedData> getSharedData() { return std::static_pointer_cast<SearchSharedData>(shared_data_); }
+};
+
+// threads searching the same tree of a ZeroActor, a batch is selected by all threads, evaluated by the network at once, then backed up by all threads
+class SearchParalleler : public utils::BaseParalleler {
+public:
+    SearchParalleler(ZeroActor* actor, int num_threads);
+
+    void initialize() override {}
+    void summarize() override {}
+
+    void selectSimulations(int num_simulations);
+    void backupSimulations(const std::vector<std::shared_ptr<network::NetworkOutput>>& network_outputs);
+    int getNumNetworkEvaluations();
+
+protected:
+    void createSharedData() override { shared_data_ = std::make_shared<SearchSharedData>(); }
+    std::shared_ptr<utils::BaseSlaveThread> newSlaveThread(int id) override { return std::make_shared<SearchSlaveThread>(id, shared_data_); }
+    inline std::shared_ptr<SearchSharedData> getSharedData() { return std::static_pointer_cast<SearchSharedData>(shared_data_); }
+};
+
+} // namespace minizero::actor
@@ -1,7 +1,21 @@
 #pragma once
 
+#include "tree_node_pool.h"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 namespace minizero::actor {
@@ -12,8 +26,10 @@ public:
     TreeData() { reset(); }
 
     inline void reset() { data_.clear(); }
+    // thread-safe against other stores
     inline int store(const Data& data)
     {
+        std::lock_guard<std::mutex> lock(mutex_);
         int index = data_.size();
         data_.push_back(data);
         return index;
@@ -23,82 +39,223 @@ public:
         assert(index >= 0 && index < size());
         return data_[index];
     }
+    // thread-safe against stores
+    inline Data loadData(int index)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return getData(index);
+    }
     inline int size() const { return data_.size(); }
 
+    // keep only the data at the given indices, in the given order
+    inline void keep(const std::vector<int>& indices)
+    {
+        std::vector<Data> data;
+        data.reserve(indices.size());
+        for (int index : indices) {
+            assert(index >= 0 && index < size());
+            data.push_back(std::move(data_[index]));
+        }
+        data_.swap(data);
+    }
+
 private:
     std::vector<Data> data_;
+    std::mutex mutex_;
 };
 
+// nodes are stored contiguously in the tree, and a node refers to its children by an offset relative to itself
+// the offset also publishes the children to concurrent searches: 0 for a leaf, kClaimedChildren while a thread is setting the children
+// the children may be split into several blocks, where each block but the last ends with a rest node whose children are the next block
+template <class Node>
 class TreeNode {
 public:
-    TreeNode() {}
-    virtual ~TreeNode() = default;
+    static constexpr int kMaxNumChildren = (1 << 12) - 1;
+    static constexpr int32_t kClaimedChildren = std::numeric_limits<int32_t>::min();
+    static constexpr int kRestActionID = std::numeric_limits<int16_t>::min();
 
-    virtual void reset() = 0;
-    virtual std::string toString() const = 0;
-    virtual bool displayInTreeLog() const { return true; }
+    inline bool isLeaf() const
+    {
+        const int32_t first_child = __atomic_load_n(&first_child_, __ATOMIC_ACQUIRE);
+        return (first_child == 0 || first_child == kClaimedChildren);
+    }
+    inline void setAction(const Action& action)
+    {
+        assert(action.getActionID() >= std::numeric_limits<int16_t>::min() && action.getActionID() <= std::numeric_limits<int16_t>::max());
+        action_id_ = action.getActionID();
+        storeBits(kPlayerMask, static_cast<uint16_t>(action.getPlayer()) << kPlayerShift);
+    }
+    inline void setNumChildren(int num_children)
+    {
+        assert(num_children >= 0 && num_children <= kMaxNumChildren);
+        storeBits(kNumChildrenMask, num_children);
+    }
+    inline void setFirstChild(Node* first_child) { first_child_ = getOffset(first_child); }
 
-    inline bool isLeaf() const { return (num_children_ == 0); }
-    inline void setAction(Action action) { action_ = action; }
-    inline void setNumChildren(int num_children) { num_children_ = num_children; }
-    inline void setFirstChild(TreeNode* first_child) { first_child_ = first_child; }
-    inline Action getAction() const { return action_; }
-    inline int getNumChildren() const { return num_children_; }
-    inline virtual TreeNode* getChild(int index) const { return (index < num_children_ ? first_child_ + index : nullptr); }
+    // claim a leaf node before setting its children, only one of the threads claiming the same node succeeds
+    inline bool claimChildren()
+    {
+        int32_t leaf = 0;
+        return __atomic_compare_exchange_n(&first_child_, &leaf, kClaimedChildren, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+    }
+
+    // set the children of a claimed node, which become visible to other threads at once
+    inline void publishChildren(Node* first_child, int num_children)
+    {
+        assert(first_child_ == kClaimedChildren && first_child && num_children > 0);
+        setNumChildren(num_children);
+        __atomic_store_n(&first_child_, getOffset(first_child), __ATOMIC_RELEASE);
+    }
+    inline Action getAction() const { return Action(action_id_, getPlayer()); }
+    inline env::Player getPlayer() const { return static_cast<env::Player>((loadBits() & kPlayerMask) >> kPlayerShift); }
+    inline bool isRest() const { return action_id_ == kRestActionID; }
+    // the number of children and the children in the first block only, which may end with a rest node
+    inline int getNumChildren() const { return loadBits() & kNumChildrenMask; }
+    inline Node* getChild(int index) const { return (index < getNumChildren() ? const_cast<Node*>(static_cast<const Node*>(this)) + first_child_ + index : nullptr); }
+
+    // all children in all blocks, without rest nodes
+    std::vector<Node*> getChildren() const
+    {
+        std::vector<Node*> children;
+        const TreeNode* block = this;
+        while (block && !block->isLeaf()) {
+            const TreeNode* next_block = nullptr;
+            for (int i = 0; i < block->getNumChildren(); ++i) {
+                Node* child = block->getChild(i);
+                if (child->isRest()) {
+                    next_block = child;
+                } else {
+                    children.push_back(child);
+                }
+            }
+            block = next_block;
+        }
+        return children;
+    }
 
 protected:
-    Action action_;
-    int num_children_;
-    TreeNode* first_child_;
+    inline void resetChildren()
+    {
+        storeBits(kNumChildrenMask, 0);
+        first_child_ = 0;
+    }
+
+    // the value proven by the search, see MCTSNode::Proof
+    inline int getProofBits() const { return (loadBits() & kProofMask) >> kProofShift; }
+    inline void setProofBits(int proof) { storeBits(kProofMask, proof << kProofShift); }
+
+    // the number of children, the player and the proof share a word, which is only changed by a compare-and-swap
+    // since a backup may prove a node while another thread widens its children
+    inline uint16_t loadBits() const { return __atomic_load_n(&bits_, __ATOMIC_RELAXED); }
+    inline void storeBits(uint16_t mask, uint16_t value)
+    {
+        assert((value & ~mask) == 0);
+        uint16_t bits = loadBits();
+        while (!__atomic_compare_exchange_n(&bits_, &bits, static_cast<uint16_t>((bits & ~mask) | value), true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+    }
+
+    inline int32_t getOffset(Node* node) const
+    {
+        const int64_t offset = (node ? node - static_cast<const Node*>(this) : 0);
+        assert(offset > std::numeric_limits<int32_t>::min() && offset <= std::numeric_limits<int32_t>::max());
+        return static_cast<int32_t>(offset);
+    }
+
+    int32_t first_child_;
+    int16_t action_id_;
+    uint16_t bits_; // the number of children in bits 0-11, the player in bits 12-13, and the proof in bits 14-15
+
+    static constexpr uint16_t kNumChildrenMask = 0x0fff;
+    static constexpr int kPlayerShift = 12;
+    static constexpr uint16_t kPlayerMask = 0x3000;
+    static constexpr int kProofShift = 14;
+    static constexpr uint16_t kProofMask = 0xc000;
 };
 
+// the nodes of a tree are allocated in chunks of the node pool, which may be shared with other trees
+// a block of children never spans two chunks, so nodes are addressed by a logical index where a chunk may end with unused slots
+template <class Node>
 class Tree {
 public:
-    Tree(uint64_t tree_node_size)
+    Tree(uint64_t tree_node_size, std::shared_ptr<TreeNodePool> tree_node_pool = nullptr)
         : tree_node_size_(tree_node_size),
-          nodes_(nullptr)
+          tree_node_pool_(tree_node_pool ? tree_node_pool : std::make_shared<TreeNodePool>((1 + tree_node_size) * sizeof(Node), 1))
+    {
+        static_assert(std::is_trivially_copyable<Node>::value && std::is_trivially_destructible<Node>::value, "nodes live in raw chunk memory");
+        assert(tree_node_size >= 0 && tree_node_pool_->getChunkSize() % sizeof(Node) == 0);
+        assert(tree_node_pool_->getChunkSize() * tree_node_pool_->getNumChunks() / sizeof(Node) <= static_cast<uint64_t>(std::numeric_limits<int32_t>::max()));
+        chunk_node_size_ = tree_node_pool_->getChunkSize() / sizeof(Node);
+        chunks_.assign(getMaxNumChunks(tree_node_size_, chunk_node_size_), nullptr);
+    }
+    Tree(const Tree&) = delete;
+    Tree& operator=(const Tree&) = delete;
+    virtual ~Tree() { releaseChunks(0); }
+
+    // the number of chunks a tree may need, as blocks larger than half a chunk are never allocated
+    static inline uint64_t getMaxNumChunks(uint64_t tree_node_size, uint64_t chunk_node_size)
     {
-        assert(tree_node_size >= 0);
+        if (chunk_node_size >= 1 + tree_node_size) { return 1; }
+        return (2 * (1 + tree_node_size) + chunk_node_size - 1) / chunk_node_size + 1;
     }
 
     inline void reset()
     {
-        if (!nodes_) { nodes_ = createTreeNodes(1 + tree_node_size_); }
+        releaseChunks(1);
+        if (!chunks_[0]) { chunks_[0] = static_cast<Node*>(tree_node_pool_->acquireChunk()); }
         current_node_size_ = 1;
         getRootNode()->reset();
     }
 
-    inline TreeNode* allocateNodes(int size)
+    // thread-safe
+    inline Node* allocateNodes(int size)
     {
-        assert(current_node_size_ + size <= tree_node_size_);
-        TreeNode* node = getNodeIndex(current_node_size_);
-        current_node_size_ += size;
-        return node;
+        assert(size > 0 && (chunk_node_size_ >= 1 + tree_node_size_ || static_cast<uint64_t>(2 * size) <= chunk_node_size_));
+        uint64_t index = current_node_size_.load(std::memory_order_relaxed), new_index;
+        do {
+            new_index = index;
+            if (new_index % chunk_node_size_ + size > chunk_node_size_) { new_index = (new_index / chunk_node_size_ + 1) * chunk_node_size_; }
+        } while (!current_node_size_.compare_exchange_weak(index, new_index + size, std::memory_order_relaxed));
+        if (new_index + size > chunks_.size() * chunk_node_size_ || (chunk_node_size_ >= 1 + tree_node_size_ && new_index + size > 1 + tree_node_size_)) {
+            std::cerr << "tree exhausted: " << new_index + size << " node slots exceed the tree node size " << tree_node_size_ << std::endl;
+            std::abort();
+        }
+
+        // the first allocation in a chunk acquires it from the pool
+        const uint64_t chunk_index = new_index / chunk_node_size_;
+        Node* chunk = __atomic_load_n(&chunks_[chunk_index], __ATOMIC_ACQUIRE);
+        if (!chunk) {
+            std::lock_guard<std::mutex> lock(chunk_mutex_);
+            chunk = chunks_[chunk_index];
+            if (!chunk) {
+                chunk = static_cast<Node*>(tree_node_pool_->acquireChunk());
+                __atomic_store_n(&chunks_[chunk_index], chunk, __ATOMIC_RELEASE);
+            }
+        }
+        return chunk + new_index % chunk_node_size_;
     }
 
-    std::string toString(const std::string& env_string)
+    std::string toString(const std::string& env_string) const
     {
         assert(!env_string.empty() && env_string.back() == ')');
         std::ostringstream oss;
-        TreeNode* pRoot = getRootNode();
+        const Node* pRoot = getRootNode();
         std::string env_prefix = env_string.substr(0, env_string.size() - 1);
         oss << env_prefix << "C[" << pRoot->toString() << "]" << getTreeInfo_r(pRoot) << ")";
         return oss.str();
     }
 
-    std::string getTreeInfo_r(const TreeNode* node) const
+    std::string getTreeInfo_r(const Node* node) const
     {
         std::ostringstream oss;
 
+        const std::vector<Node*> children = node->getChildren();
         int numChildren = 0;
-        for (int i = 0; i < node->getNumChildren(); ++i) {
-            TreeNode* child = node->getChild(i);
+        for (const Node* child : children) {
             if (child->isLeaf()) { continue; }
             ++numChildren;
         }
 
-        for (int i = 0; i < node->getNumChildren(); ++i) {
-            TreeNode* child = node->getChild(i);
+        for (const Node* child : children) {
             if (!child->displayInTreeLog()) { continue; }
             if (numChildren > 1) { oss << "("; }
             oss << playerToChar(child->getAction().getPlayer())
@@ -109,16 +266,119 @@ public:
         return oss.str();
     }
 
-    inline TreeNode* getRootNode() { return &nodes_[0]; }
-    inline const TreeNode* getRootNode() const { return &nodes_[0]; }
+    // make the node the new root by moving its subtree to the front of the tree, the rest of the tree is discarded
+    // children in the first block of the new root are dropped unless accepted by keep_root_child, which should keep its rest node
+    // visit_node is called with every node of the new tree once it is moved
+    template <class Predicate, class Visitor>
+    void moveSubtreeToRoot(Node* new_root, Predicate keep_root_child, Visitor visit_node)
+    {
+        const std::vector<std::pair<const Node*, uint64_t>> sorted_chunks = getSortedChunks();
+        assert(new_root != getRootNode() && getIndex(new_root, sorted_chunks) < current_node_size_);
+
+        // collect the children blocks of the subtree as (index of the first child, number of children)
+        // a block may be shared by several nodes (see MCTS::shareChildren), and is collected only once
+        std::vector<std::pair<uint64_t, int>> blocks;
+        std::unordered_set<Node*> visited_blocks;
+        std::vector<Node*> stack;
+        for (int i = 0; i < new_root->getNumChildren(); ++i) {
+            Node* child = new_root->getChild(i);
+            if (!keep_root_child(child)) { continue; }
+            blocks.emplace_back(getIndex(child, sorted_chunks), 1);
+            stack.push_back(child);
+        }
+        const int num_root_children = blocks.size();
+        const uint64_t first_root_child = (num_root_children > 0 ? blocks[0].first : 0);
+        while (!stack.empty()) {
+            Node* node = stack.back();
+            stack.pop_back();
+            if (node->isLeaf() || !visited_blocks.insert(node->getChild(0)).second) { continue; }
+            blocks.emplace_back(getIndex(node->getChild(0), sorted_chunks), node->getNumChildren());
+            for (int i = 0; i < node->getNumChildren(); ++i) { stack.push_back(node->getChild(i)); }
+        }
+
+        // blocks are packed in their original order, so a block never moves backward over a block not yet moved
+        std::sort(blocks.begin(), blocks.end());
+        std::vector<uint64_t> new_indices(blocks.size());
+        uint64_t new_node_size = 1;
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            if (new_node_size % chunk_node_size_ + blocks[i].second > chunk_node_size_) { new_node_size = (new_node_size / chunk_node_size_ + 1) * chunk_node_size_; }
+            new_indices[i] = new_node_size;
+            new_node_size += blocks[i].second;
+        }
+        auto getNewNode = [&](uint64_t old_index) {
+            auto it = std::lower_bound(blocks.begin(), blocks.end(), std::make_pair(old_index, 0));
+            assert(it != blocks.end() && it->first == old_index);
+            return getNode(new_indices[it - blocks.begin()]);
+        };
+
+        *getRootNode() = *new_root;
+        getRootNode()->setNumChildren(num_root_children);
+        getRootNode()->setFirstChild(num_root_children > 0 ? getNewNode(first_root_child) : nullptr);
+        visit_node(getRootNode());
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            for (int j = 0; j < blocks[i].second; ++j) {
+                Node* old_node = getNode(blocks[i].first + j);
+                Node* new_node = getNode(new_indices[i] + j);
+                Node* first_child = (old_node->isLeaf() ? nullptr : getNewNode(getIndex(old_node->getChild(0), sorted_chunks)));
+                if (new_node != old_node) { *new_node = *old_node; }
+                new_node->setFirstChild(first_child);
+                visit_node(new_node);
+            }
+        }
+        current_node_size_ = new_node_size;
+        releaseChunks((new_node_size + chunk_node_size_ - 1) / chunk_node_size_);
+    }
+
+    inline Node* getRootNode() { return chunks_[0]; }
+    inline const Node* getRootNode() const { return chunks_[0]; }
+    // the number of nodes allocated, including the unused slots at the end of chunks
+    inline uint64_t getNumAllocatedNodes() const { return current_node_size_; }
+    inline const std::shared_ptr<TreeNodePool>& getTreeNodePool() const { return tree_node_pool_; }
 
 protected:
-    virtual TreeNode* createTreeNodes(uint64_t tree_node_size) = 0;
-    virtual TreeNode* getNodeIndex(int index) = 0;
+    inline Node* getNode(uint64_t index) const
+    {
+        assert(index < current_node_size_ && chunks_[index / chunk_node_size_]);
+        return chunks_[index / chunk_node_size_] + index % chunk_node_size_;
+    }
+
+    // the acquired chunks as (address, chunk index) sorted by address, so that getIndex is a binary search
+    std::vector<std::pair<const Node*, uint64_t>> getSortedChunks() const
+    {
+        std::vector<std::pair<const Node*, uint64_t>> sorted_chunks;
+        for (uint64_t chunk_index = 0; chunk_index < chunks_.size(); ++chunk_index) {
+            if (chunks_[chunk_index]) { sorted_chunks.emplace_back(chunks_[chunk_index], chunk_index); }
+        }
+        std::sort(sorted_chunks.begin(), sorted_chunks.end(), [](const auto& lhs, const auto& rhs) { return std::less<const Node*>()(lhs.first, rhs.first); });
+        return sorted_chunks;
+    }
+
+    uint64_t getIndex(const Node* node, const std::vector<std::pair<const Node*, uint64_t>>& sorted_chunks) const
+    {
+        // the last chunk starting at or before the node
+        auto it = std::upper_bound(sorted_chunks.begin(), sorted_chunks.end(), node, [](const Node* node, const auto& chunk) { return std::less<const Node*>()(node, chunk.first); });
+        assert(it != sorted_chunks.begin());
+        --it;
+        assert(node < it->first + chunk_node_size_);
+        return it->second * chunk_node_size_ + (node - it->first);
+    }
+
+    // return the chunks from the given one onward to the pool
+    inline void releaseChunks(uint64_t first_chunk_index)
+    {
+        for (uint64_t chunk_index = first_chunk_index; chunk_index < chunks_.size(); ++chunk_index) {
+            if (!chunks_[chunk_index]) { continue; }
+            tree_node_pool_->releaseChunk(chunks_[chunk_index]);
+            chunks_[chunk_index] = nullptr;
+        }
+    }
 
     uint64_t tree_node_size_;
-    uint64_t current_node_size_;
-    TreeNode* nodes_;
+    uint64_t chunk_node_size_;
+    std::atomic<uint64_t> current_node_size_;
+    std::shared_ptr<TreeNodePool> tree_node_pool_;
+    std::vector<Node*> chunks_;
+    std::mutex chunk_mutex_;
 };
 
 } // namespace minizero::actor
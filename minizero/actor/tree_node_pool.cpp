@@ -0,0 +1,86 @@
+#include "tree_node_pool.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+#if __has_include(<linux/mempolicy.h>)
+#include <linux/mempolicy.h>
+#endif
+
+namespace minizero::actor {
+
+TreeNodePool::TreeNodePool(size_t chunk_size, size_t num_chunks, HugePage huge_page /* = HugePage::kNone */, int numa_node /* = -1 */)
+    : chunk_size_(chunk_size),
+      num_chunks_(num_chunks),
+      region_(nullptr),
+      is_huge_page_backed_(false),
+      num_touched_chunks_(0),
+      num_used_chunks_(0),
+      peak_num_used_chunks_(0)
+{
+    assert(chunk_size > 0 && num_chunks > 0);
+    region_size_ = (chunk_size_ * num_chunks_ + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+    void* region = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    // explicit huge pages are reserved by the mmap, and it fails if not enough are configured (vm.nr_hugepages)
+    if (huge_page == HugePage::kExplicit) {
+        region = mmap(nullptr, region_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        is_huge_page_backed_ = (region != MAP_FAILED);
+    }
+#endif
+    if (region == MAP_FAILED) { region = mmap(nullptr, region_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0); }
+    if (region == MAP_FAILED) {
+        std::cerr << "failed to reserve " << region_size_ << " bytes for tree nodes" << std::endl;
+        std::abort();
+    }
+#ifdef MADV_HUGEPAGE
+    if (huge_page != HugePage::kNone && !is_huge_page_backed_) { is_huge_page_backed_ = (madvise(region, region_size_, MADV_HUGEPAGE) == 0); }
+#endif
+#if defined(SYS_mbind) && defined(MPOL_PREFERRED)
+    // mbind(2) without libnuma, a page is still only allocated when first touched, but then on the node if it has free memory
+    if (numa_node >= 0) {
+        const size_t num_mask_bits = 8 * sizeof(unsigned long);
+        std::vector<unsigned long> node_mask(numa_node / num_mask_bits + 1, 0);
+        node_mask[numa_node / num_mask_bits] |= 1UL << (numa_node % num_mask_bits);
+        if (syscall(SYS_mbind, region, region_size_, MPOL_PREFERRED, node_mask.data(), node_mask.size() * num_mask_bits + 1, 0) != 0) { std::cerr << "failed to place tree nodes on NUMA node " << numa_node << std::endl; }
+    }
+#endif
+    region_ = static_cast<char*>(region);
+}
+
+TreeNodePool::~TreeNodePool()
+{
+    if (region_) { munmap(region_, region_size_); }
+}
+
+void* TreeNodePool::acquireChunk()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    char* chunk = nullptr;
+    if (!free_chunks_.empty()) {
+        chunk = free_chunks_.back();
+        free_chunks_.pop_back();
+    } else {
+        if (num_touched_chunks_ >= num_chunks_) {
+            std::cerr << "tree node pool exhausted: all " << num_chunks_ << " chunks of " << chunk_size_ << " bytes are in use" << std::endl;
+            std::abort();
+        }
+        chunk = region_ + chunk_size_ * num_touched_chunks_++;
+    }
+    peak_num_used_chunks_ = std::max(peak_num_used_chunks_, ++num_used_chunks_);
+    return chunk;
+}
+
+void TreeNodePool::releaseChunk(void* chunk)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    assert(chunk >= region_ && static_cast<char*>(chunk) < region_ + chunk_size_ * num_touched_chunks_);
+    free_chunks_.push_back(static_cast<char*>(chunk));
+    --num_used_chunks_;
+}
+
+} // namespace minizero::actor
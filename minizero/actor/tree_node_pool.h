@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace minizero::actor {
+
+// memory for tree nodes, handed out in fixed-size chunks and shared by the trees of several actors
+// the whole pool is reserved as one virtual region, so that two nodes of a tree in different chunks are close enough for
+// the 32-bit child offsets of TreeNode; a page is only backed by memory when first touched, and released chunks are reused
+class TreeNodePool {
+public:
+    enum class HugePage {
+        kNone,
+        kTransparent, // madvise(MADV_HUGEPAGE)
+        kExplicit     // mmap(MAP_HUGETLB), which reserves the huge pages of the whole pool, or kTransparent if not enough are configured
+    };
+
+    // the chunk size should be a multiple of the node size, so that the nodes of all chunks are evenly spaced
+    // the memory is preferably placed on the given NUMA node, or by the first touch if numa_node is -1
+    TreeNodePool(size_t chunk_size, size_t num_chunks, HugePage huge_page = HugePage::kNone, int numa_node = -1);
+    TreeNodePool(const TreeNodePool&) = delete;
+    TreeNodePool& operator=(const TreeNodePool&) = delete;
+    ~TreeNodePool();
+
+    // thread-safe
+    void* acquireChunk();
+    void releaseChunk(void* chunk);
+
+    inline size_t getChunkSize() const { return chunk_size_; }
+    inline size_t getNumChunks() const { return num_chunks_; }
+    inline bool isHugePageBacked() const { return is_huge_page_backed_; }
+    inline size_t getNumUsedChunks() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return num_used_chunks_;
+    }
+    inline size_t getPeakNumUsedChunks() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return peak_num_used_chunks_;
+    }
+
+    static const size_t kHugePageSize = 2 << 20;
+
+private:
+    size_t chunk_size_; // in bytes
+    size_t num_chunks_;
+    size_t region_size_;
+    char* region_;
+    bool is_huge_page_backed_;
+
+    mutable std::mutex mutex_;
+    size_t num_touched_chunks_; // chunks [0, num_touched_chunks_) have been handed out at least once
+    size_t num_used_chunks_;
+    size_t peak_num_used_chunks_;
+    std::vector<char*> free_chunks_;
+};
+
+} // namespace minizero::actor
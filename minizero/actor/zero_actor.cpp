@@ -2,6 +2,7 @@
 #include "random.h"
 #include "time_system.h"
 #include <algorithm>
+#include <cmath>
 #include <memory>
 #include <unordered_map>
 #include <utility>
@@ -15,87 +16,164 @@ using namespace network;
 void MCTSSearchData::clear()
 {
     search_info_ = "";
+    num_reused_visits_ = 0;
     selected_node_ = nullptr;
-    node_path_.clear();
+    simulation_.node_path_.clear();
 }
 
 void ZeroActor::reset()
 {
+    reuse_node_ = nullptr;
+    num_pondered_visits_ = num_ponder_saved_visits_ = 0;
+    num_game_terminal_leaves_ = 0;
     BaseActor::reset();
     enable_resign_ = (utils::Random::randReal() < config::zero_disable_resign_ratio ? false : true);
 }
 
-void ZeroActor::resetSearch()
+void ZeroActor::resetSearch(bool is_fast_search)
 {
-    BaseActor::resetSearch();
-    mcts_search_data_.node_path_.clear();
-    getMCTS()->getRootNode()->setAction(Action(-1, env::getPreviousPlayer(env_.getTurn(), env_.getNumPlayer())));
+    pending_outputs_.clear(); // the outputs of an abandoned search are dropped by the inference service
+    is_pondered_ = false;
+    is_fast_search_ = is_fast_search;
+    if (!reuseSubtree()) {
+        BaseActor::resetSearch();
+        getMCTS()->getRootNode()->setAction(Action(-1, env::getPreviousPlayer(env_.getTurn(), env_.getNumPlayer())));
+    }
+    mcts_search_data_.clear();
+    mcts_search_data_.num_reused_visits_ = getMCTS()->getNumSimulation();
+    num_network_batches_ = num_network_evaluations_ = num_wasted_slots_ = num_duplicate_leaves_ = 0;
+    num_search_start_terminal_leaves_ = num_game_terminal_leaves_;
+    num_cache_hits_ = 0;
+    reuse_node_ = getMCTS()->getRootNode();
+    search_envs_.resize(std::max(1, config::actor_mcts_think_num_threads));
+    if (env_.supportUndo()) {
+        for (auto& env : search_envs_) {
+            env = env_;
+            env.checkpoint();
+        }
+    }
+}
+
+void ZeroActor::resetSelfPlaySearch()
+{
+    resetSearch(alphazero_network_ && !config::actor_use_gumbel && utils::Random::randReal() < config::actor_playout_cap_fast_ratio);
+}
+
+bool ZeroActor::act(const Action& action)
+{
+    if (!BaseActor::act(action)) { return false; }
+    followPlayedAction();
+    return true;
+}
+
+bool ZeroActor::act(const std::vector<std::string>& action_string_args)
+{
+    if (!BaseActor::act(action_string_args)) { return false; }
+    followPlayedAction();
+    return true;
 }
 
 Action ZeroActor::think(bool with_play /*= false*/, bool display_board /*= false*/)
 {
     resetSearch();
+    const float time_limit = (think_time_limit_ > 0 ? think_time_limit_ : config::actor_mcts_think_time_limit);
+    const float max_time_limit = (think_time_limit_ > 0 ? max_think_time_limit_ : time_limit * (1 + config::actor_mcts_think_time_extension));
+    const int num_start_simulation = getMCTS()->getNumSimulation();
+    bool is_early_stopped = false;
     boost::posix_time::ptime start_ptime = utils::TimeSystem::getLocalTime();
+    float spent_second = 0.0f;
     while (!isSearchDone()) {
         step();
-        int spent_million_second = (utils::TimeSystem::getLocalTime() - start_ptime).total_milliseconds();
-        if (config::actor_mcts_think_time_limit > 0 && spent_million_second >= config::actor_mcts_think_time_limit * 1000) { break; }
+        spent_second = (utils::TimeSystem::getLocalTime() - start_ptime).total_milliseconds() / 1000.0f;
+        // the time limit is extended while the two best actions are close
+        if (time_limit > 0 && spent_second >= time_limit && (spent_second >= max_time_limit || !isBestActionClose())) { break; }
+        if (config::actor_mcts_think_early_stop && isBestActionDecided(getMCTS()->getNumSimulation() - num_start_simulation, spent_second, (spent_second < time_limit ? time_limit : max_time_limit))) {
+            is_early_stopped = true;
+            break;
+        }
     }
-    if (!isSearchDone()) { handleSearchDone(); }
+    if (!mcts_search_data_.selected_node_) { handleSearchDone(); }
+    // the simulations per second of each actor_mcts_think_num_threads show the scaling of the parallel search
+    const int num_searched_simulation = getMCTS()->getNumSimulation() - num_start_simulation;
+    std::ostringstream oss;
+    oss << "search time: " << spent_second << " s";
+    if (time_limit > 0) { oss << " (limit: " << time_limit << " s, max: " << max_time_limit << " s)"; }
+    oss << ", searched simulations: " << num_searched_simulation << (is_early_stopped ? ", stopped early" : "")
+        << ", simulations/sec: " << (spent_second > 0 ? num_searched_simulation / spent_second : 0.0f)
+        << " (" << std::max(1, config::actor_mcts_think_num_threads) << " threads)" << std::endl;
+    mcts_search_data_.search_info_ += oss.str();
+    think_time_limit_ = max_think_time_limit_ = 0;
     if (with_play) { act(getSearchAction()); }
     if (display_board) { std::cerr << env_.toString() << mcts_search_data_.search_info_ << std::endl; }
     return getSearchAction();
 }
 
+void ZeroActor::ponder(const std::atomic<bool>& stop_ponder, int num_simulation)
+{
+    // the opponent's turn is searched in the reused tree of the played action, so any actual reply keeps its pondered subtree
+    if (!config::actor_mcts_reuse_tree || config::actor_use_gumbel || env_.isTerminal()) { return; }
+    if (!is_pondered_) {
+        resetSearch();
+        is_pondered_ = true;
+        ponder_root_counts_.clear();
+        for (MCTSNode* child : getMCTS()->getRootNode()->getChildren()) { ponder_root_counts_[child->getAction().getActionID()] = child->getCount(); }
+    }
+
+    is_pondering_ = true;
+    const int num_start_simulation = getMCTS()->getNumSimulation();
+    while (!stop_ponder && !isSearchDone() && (num_simulation <= 0 || num_pondered_visits_ + getMCTS()->getNumSimulation() - num_start_simulation < num_simulation)) { step(); }
+    num_pondered_visits_ += getMCTS()->getNumSimulation() - num_start_simulation;
+    is_pondering_ = false;
+}
+
 void ZeroActor::beforeNNEvaluation()
 {
-    mcts_search_data_.node_path_ = selection();
-    if (alphazero_network_) {
-        Environment env_transition = getEnvironmentTransition(mcts_search_data_.node_path_);
-        feature_rotation_ = config::actor_use_random_rotation_features ? static_cast<utils::Rotation>(utils::Random::randInt() % static_cast<int>(utils::Rotation::kRotateSize)) : utils::Rotation::kRotationNone;
-        nn_evaluation_batch_id_ = alphazero_network_->pushBack(env_transition.getFeatures(feature_rotation_));
-    } else if (muzero_network_) {
-        if (getMCTS()->getNumSimulation() == 0) { // initial inference for root node
-            nn_evaluation_batch_id_ = muzero_network_->pushBackInitialData(env_.getFeatures());
-        } else { // for non-root nodes
-            const std::vector<MCTSNode*>& node_path = mcts_search_data_.node_path_;
-            MCTSNode* leaf_node = node_path.back();
-            MCTSNode* parent_node = node_path[node_path.size() - 2];
-            assert(parent_node && parent_node->getHiddenStateDataIndex() != -1);
-            const std::vector<float>& hidden_state = getMCTS()->getTreeHiddenStateData().getData(parent_node->getHiddenStateDataIndex()).hidden_state_;
-            nn_evaluation_batch_id_ = muzero_network_->pushBackRecurrentData(hidden_state, env_.getActionFeatures(leaf_node->getAction()));
+    assert(alphazero_network_ || muzero_network_);
+    MCTSSimulation& simulation = mcts_search_data_.simulation_;
+    simulation.node_path_ = selection();
+    // a leaf node with virtual loss is already waiting for the network evaluation
+    while (!pushBackSimulation(simulation, 0, simulation.node_path_.back()->getVirtualLoss() == 0)) {
+        if (simulation.cached_output_) {
+            expandAndBackup(simulation, simulation.cached_output_);
+            simulation.cached_output_ = nullptr;
         }
-    } else {
-        assert(false);
+        if (config::actor_use_gumbel) { gumbel_zero_.sequentialHalving(getMCTS()); }
+        if (isSearchDone()) {
+            // no network evaluation is pending for this search
+            handleSearchDone();
+            nn_evaluation_batch_id_ = -1;
+            return;
+        }
+        simulation.node_path_ = selection();
     }
+    nn_evaluation_batch_id_ = simulation.nn_evaluation_batch_id_;
 }
 
 void ZeroActor::afterNNEvaluation(const std::shared_ptr<NetworkOutput>& network_output)
 {
-    const std::vector<MCTSNode*>& node_path = mcts_search_data_.node_path_;
-    MCTSNode* leaf_node = node_path.back();
-    if (alphazero_network_) {
-        Environment env_transition = getEnvironmentTransition(node_path);
-        if (!env_transition.isTerminal()) {
-            std::shared_ptr<AlphaZeroNetworkOutput> alphazero_output = std::static_pointer_cast<AlphaZeroNetworkOutput>(network_output);
-            getMCTS()->expand(leaf_node, calculateAlphaZeroActionPolicy(env_transition, alphazero_output, feature_rotation_));
-            getMCTS()->backup(node_path, alphazero_output->value_, env_transition.getReward());
-        } else {
-            getMCTS()->backup(node_path, env_transition.getEvalScore(), env_transition.getReward());
-        }
-    } else if (muzero_network_) {
-        std::shared_ptr<MuZeroNetworkOutput> muzero_output = std::static_pointer_cast<MuZeroNetworkOutput>(network_output);
-        getMCTS()->expand(leaf_node, calculateMuZeroActionPolicy(leaf_node, muzero_output));
-        getMCTS()->backup(node_path, muzero_output->value_, muzero_output->reward_);
-        leaf_node->setHiddenStateDataIndex(getMCTS()->getTreeHiddenStateData().store(HiddenStateData(muzero_output->hidden_state_)));
-    } else {
-        assert(false);
-    }
-    if (leaf_node == getMCTS()->getRootNode()) { addNoiseToNodeChildren(leaf_node); }
-    if (isSearchDone()) { handleSearchDone(); }
+    expandAndBackup(mcts_search_data_.simulation_, network_output);
+    if (isSearchDone() && !mcts_search_data_.selected_node_) { handleSearchDone(); }
     if (config::actor_use_gumbel) { gumbel_zero_.sequentialHalving(getMCTS()); }
 }
 
+void ZeroActor::selectSimulation(MCTSSimulation& simulation, int thread_id)
+{
+    // only the first simulation reaching a leaf node evaluates it, the others just keep their virtual losses until the backup
+    simulation.nn_evaluation_batch_id_ = -1;
+    simulation.cached_output_ = nullptr;
+    simulation.node_path_ = getMCTS()->select();
+    for (size_t i = 0; i + 1 < simulation.node_path_.size(); ++i) { simulation.node_path_[i]->addVirtualLoss(); }
+    if (simulation.node_path_.back()->addVirtualLoss() > 0) { return; }
+    pushBackSimulation(simulation, thread_id, true);
+}
+
+void ZeroActor::backupSimulation(const MCTSSimulation& simulation, const std::shared_ptr<NetworkOutput>& network_output)
+{
+    const std::shared_ptr<NetworkOutput>& output = (network_output ? network_output : simulation.cached_output_);
+    if (output) { expandAndBackup(simulation, output); }
+    for (auto node : simulation.node_path_) { node->removeVirtualLoss(); }
+}
+
 void ZeroActor::setNetwork(const std::shared_ptr<network::Network>& network)
 {
     assert(network);
@@ -129,32 +207,79 @@ void ZeroActor::step()
 {
     assert(alphazero_network_ || muzero_network_);
     int num_simulation = getMCTS()->getNumSimulation();
-    int num_simulation_left = config::actor_num_simulation + 1 - num_simulation;
+    int num_simulation_left = getNumSimulationLimit() + 1 - num_simulation;
     int batch_size = std::min(config::actor_mcts_think_batch_size,
                               (alphazero_network_ || num_simulation > 0) ? num_simulation_left : 1 /* initial inference for root node */);
     assert(batch_size > 0);
-    std::vector<std::pair<int, decltype(mcts_search_data_.node_path_)>> node_path_evaluated;
-    for (int batch_id = 0; batch_id < batch_size; batch_id++) {
-        beforeNNEvaluation();
-        assert(nn_evaluation_batch_id_ == batch_id);
-        if (mcts_search_data_.node_path_.back()->getVirtualLoss() == 0) {
-            node_path_evaluated.emplace_back(batch_id, std::move(mcts_search_data_.node_path_));
+    if (useParallelSearch()) {
+        parallelStep(batch_size);
+        return;
+    }
+
+    // a selection reaching a leaf already in the batch keeps its virtual losses for the next selections to diverge, but takes no network slot
+    std::vector<MCTSSimulation> simulations;
+    int num_evaluations = 0;
+    int num_selections = 0;
+    while (num_evaluations < batch_size && num_selections < batch_size + config::actor_mcts_think_batch_refill) {
+        MCTSSimulation& simulation = mcts_search_data_.simulation_;
+        simulation.node_path_ = selection();
+        if (simulation.node_path_.back()->getVirtualLoss() > 0) {
+            ++num_duplicate_leaves_;
+            simulation.nn_evaluation_batch_id_ = -1;
+        } else if (pushBackSimulation(simulation, 0, true)) {
+            assert(simulation.nn_evaluation_batch_id_ == num_evaluations);
+            ++num_evaluations;
+        } else { // a terminal leaf, a transposition, or a cached evaluation, evaluated without the network
+            if (simulation.cached_output_) {
+                expandAndBackup(simulation, simulation.cached_output_);
+                simulation.cached_output_ = nullptr;
+            }
+            if (config::actor_use_gumbel) { gumbel_zero_.sequentialHalving(getMCTS()); }
+            if (isSearchDone()) {
+                handleSearchDone();
+                break;
+            }
+            continue;
+        }
+        ++num_selections;
+        for (auto node : simulation.node_path_) { node->addVirtualLoss(); }
+        simulations.push_back(std::move(simulation));
+    }
+    if (num_evaluations > 0) {
+        auto network_output = forwardNetwork(num_simulation == 0);
+        countNetworkEvaluations(num_evaluations, batch_size);
+        for (auto& simulation : simulations) {
+            // the search may end before the batch is backed up, by evaluations without the network or by the earlier leaves of the batch
+            if (isSearchDone()) { break; }
+            if (simulation.nn_evaluation_batch_id_ == -1) { continue; }
+            nn_evaluation_batch_id_ = simulation.nn_evaluation_batch_id_;
+            mcts_search_data_.simulation_ = simulation;
+            afterNNEvaluation(network_output[nn_evaluation_batch_id_]);
         }
-        for (auto node : mcts_search_data_.node_path_) { node->addVirtualLoss(); }
     }
-    auto network_output = alphazero_network_ ? alphazero_network_->forward()
-                                             : (num_simulation == 0 ? muzero_network_->initialInference() : muzero_network_->recurrentInference());
-    for (auto& evaluation : node_path_evaluated) {
-        nn_evaluation_batch_id_ = evaluation.first;
-        mcts_search_data_.node_path_ = std::move(evaluation.second);
-        afterNNEvaluation(network_output[nn_evaluation_batch_id_]);
-        auto virtual_loss = mcts_search_data_.node_path_.back()->getVirtualLoss();
-        for (auto node : mcts_search_data_.node_path_) { node->removeVirtualLoss(virtual_loss); }
+    // every selected path keeps one virtual loss per node, in a graph a leaf node may be reached by different paths
+    for (auto& simulation : simulations) {
+        for (auto node : simulation.node_path_) { node->removeVirtualLoss(); }
     }
 }
 
+void ZeroActor::parallelStep(int batch_size)
+{
+    if (!search_paralleler_) { search_paralleler_ = std::make_shared<SearchParalleler>(this, config::actor_mcts_think_num_threads); }
+    search_paralleler_->selectSimulations(batch_size);
+    std::vector<std::shared_ptr<NetworkOutput>> network_output;
+    const int num_evaluations = search_paralleler_->getNumNetworkEvaluations();
+    if (num_evaluations > 0) {
+        network_output = forwardNetwork(false);
+        countNetworkEvaluations(num_evaluations, batch_size);
+    }
+    search_paralleler_->backupSimulations(network_output);
+    if (isSearchDone() && !mcts_search_data_.selected_node_) { handleSearchDone(); }
+}
+
 void ZeroActor::handleSearchDone()
 {
+    if (is_pondering_) { return; } // no action is decided for the opponent's turn
     mcts_search_data_.selected_node_ = decideActionNode();
     const Action action = getSearchAction();
     std::ostringstream oss;
@@ -165,58 +290,96 @@ void ZeroActor::handleSearchDone()
         << " (" << action.getActionID() << ")"
         << ", reward: " << env_.getReward()
         << ", player: " << env::playerToChar(action.getPlayer());
-    if (config::actor_mcts_value_rescale) { oss << ", value bound: (" << getMCTS()->getTreeValueBound().begin()->first << ", " << getMCTS()->getTreeValueBound().rbegin()->first << ")"; }
+    if (config::actor_mcts_value_rescale) { oss << ", value bound: (" << getMCTS()->getTreeValueBound().getLowerBound() << ", " << getMCTS()->getTreeValueBound().getUpperBound() << ")"; }
     oss << std::endl
         << "  root node info: " << getMCTS()->getRootNode()->toString() << std::endl
         << "action node info: " << mcts_search_data_.selected_node_->toString() << std::endl;
+    if (config::actor_mcts_reuse_tree) { oss << "reused visits: " << mcts_search_data_.num_reused_visits_ << std::endl; }
+    if (num_network_batches_ > 0) {
+        oss << "network batches: " << num_network_batches_ << ", evaluations: " << num_network_evaluations_
+            << ", wasted slots: " << num_wasted_slots_ << " (duplicate leaves: " << num_duplicate_leaves_ << ")" << std::endl;
+    }
+    if (evaluation_cache_) {
+        const uint64_t num_lookups = evaluation_cache_->getNumLookups();
+        oss << "evaluation cache hits: " << num_cache_hits_ << ", all actors: " << evaluation_cache_->getNumHits() << "/" << num_lookups
+            << " (" << (num_lookups > 0 ? 100.0f * evaluation_cache_->getNumHits() / num_lookups : 0.0f) << "%)"
+            << ", entries: " << evaluation_cache_->getNumUsedEntries() << "/" << evaluation_cache_->getNumEntries()
+            << " (" << evaluation_cache_->getMemorySize() / (1024 * 1024) << " MB)"
+            << ", evictions: " << evaluation_cache_->getNumEvictions() << std::endl;
+    }
+    if (num_game_terminal_leaves_ > 0) { oss << "terminal leaves evaluated without the network: " << num_game_terminal_leaves_ - num_search_start_terminal_leaves_ << " (game: " << num_game_terminal_leaves_ << ")" << std::endl; }
+    if (num_pondered_visits_ > 0) {
+        oss << "pondered visits: " << num_pondered_visits_ << ", saved: " << num_ponder_saved_visits_ << std::endl;
+        num_pondered_visits_ = num_ponder_saved_visits_ = 0;
+    }
+    const uint64_t num_tree_nodes = getMCTS()->getNumAllocatedNodes();
+    const std::shared_ptr<TreeNodePool>& tree_node_pool = getMCTS()->getTreeNodePool();
+    ++num_searched_moves_;
+    total_tree_nodes_ += num_tree_nodes;
+    peak_tree_nodes_ = std::max(peak_tree_nodes_, num_tree_nodes);
+    oss << "tree nodes: " << num_tree_nodes << " (" << num_tree_nodes * sizeof(MCTSNode) / 1024 << " KB)"
+        << ", peak: " << peak_tree_nodes_ << ", average: " << total_tree_nodes_ / num_searched_moves_
+        << ", pool chunks in use: " << tree_node_pool->getNumUsedChunks() << "/" << tree_node_pool->getNumChunks()
+        << " (peak: " << tree_node_pool->getPeakNumUsedChunks() << ", " << tree_node_pool->getChunkSize() / 1024 << " KB each"
+        << (tree_node_pool->isHugePageBacked() ? ", huge pages" : "") << ")" << std::endl;
     mcts_search_data_.search_info_ = oss.str();
 }
 
 MCTSNode* ZeroActor::decideActionNode()
 {
+    // a proven win is played at once, and a proven loss only if every action is proven to lose
+    const MCTSNode* root = getMCTS()->getRootNode();
+    MCTSNode* proven_node = (config::actor_mcts_solver ? getMCTS()->selectChildByProof(root, MCTSNode::Proof::kWin) : nullptr);
+    if (proven_node) { return proven_node; }
+
+    MCTSNode* action_node = nullptr;
     if (config::actor_use_gumbel) {
-        return gumbel_zero_.decideActionNode(getMCTS());
+        action_node = gumbel_zero_.decideActionNode(getMCTS());
+    } else if (config::actor_select_action_by_count) {
+        action_node = getMCTS()->selectChildByMaxCount(root);
+    } else if (config::actor_select_action_by_softmax_count) {
+        action_node = getMCTS()->selectChildBySoftmaxCount(root, config::actor_select_action_softmax_temperature);
     } else {
-        if (config::actor_select_action_by_count) {
-            return getMCTS()->selectChildByMaxCount(getMCTS()->getRootNode());
-        } else if (config::actor_select_action_by_softmax_count) {
-            return getMCTS()->selectChildBySoftmaxCount(getMCTS()->getRootNode(), config::actor_select_action_softmax_temperature);
-        }
-
         assert(false);
         return nullptr;
     }
+    if (config::actor_mcts_solver && action_node->getProof() == MCTSNode::Proof::kLoss) {
+        proven_node = getMCTS()->selectChildByProof(root, MCTSNode::Proof::kUnknown);
+        if (!proven_node) { proven_node = getMCTS()->selectChildByProof(root, MCTSNode::Proof::kDraw); }
+        if (proven_node) { action_node = proven_node; }
+    }
+    return action_node;
 }
 
 void ZeroActor::addNoiseToNodeChildren(MCTSNode* node)
 {
     assert(node && node->getNumChildren() > 0);
+    const std::vector<MCTSNode*> children = node->getChildren();
     if (config::actor_use_dirichlet_noise) {
         const float epsilon = config::actor_dirichlet_noise_epsilon;
-        std::vector<float> dirichlet_noise = utils::Random::randDirichlet(config::actor_dirichlet_noise_alpha, node->getNumChildren());
-        for (int i = 0; i < node->getNumChildren(); ++i) {
-            MCTSNode* child = node->getChild(i);
+        std::vector<float> dirichlet_noise = utils::Random::randDirichlet(config::actor_dirichlet_noise_alpha, children.size());
+        for (size_t i = 0; i < children.size(); ++i) {
+            MCTSNode* child = children[i];
             child->setPolicyNoise(dirichlet_noise[i]);
             child->setPolicy((1 - epsilon) * child->getPolicy() + epsilon * dirichlet_noise[i]);
         }
     } else if (config::actor_use_gumbel_noise) {
-        std::vector<float> gumbel_noise = utils::Random::randGumbel(node->getNumChildren());
-        for (int i = 0; i < node->getNumChildren(); ++i) {
-            MCTSNode* child = node->getChild(i);
+        std::vector<float> gumbel_noise = utils::Random::randGumbel(children.size());
+        for (size_t i = 0; i < children.size(); ++i) {
+            MCTSNode* child = children[i];
             child->setPolicyNoise(gumbel_noise[i]);
             child->setPolicyLogit(child->getPolicyLogit() + gumbel_noise[i]);
         }
     }
 }
 
-std::vector<MCTS::ActionCandidate> ZeroActor::calculateAlphaZeroActionPolicy(const Environment& env_transition, const std::shared_ptr<network::AlphaZeroNetworkOutput>& alphazero_output, const utils::Rotation& rotation)
+std::vector<MCTS::ActionCandidate> ZeroActor::calculateAlphaZeroActionPolicy(const std::vector<Action>& legal_actions, const std::shared_ptr<network::AlphaZeroNetworkOutput>& alphazero_output, const utils::Rotation& rotation)
 {
     assert(alphazero_network_);
     std::vector<MCTS::ActionCandidate> action_candidates;
-    for (size_t action_id = 0; action_id < alphazero_output->policy_.size(); ++action_id) {
-        Action action(action_id, env_transition.getTurn());
-        if (!env_transition.isLegalAction(action)) { continue; }
-        int rotated_id = env_transition.getRotateAction(action_id, rotation);
+    for (const auto& action : legal_actions) {
+        int action_id = action.getActionID();
+        int rotated_id = env_.getRotateAction(action_id, rotation);
         action_candidates.push_back(MCTS::ActionCandidate(action, alphazero_output->policy_[rotated_id], alphazero_output->policy_logits_[rotated_id]));
     }
     sort(action_candidates.begin(), action_candidates.end(), [](const MCTS::ActionCandidate& lhs, const MCTS::ActionCandidate& rhs) {
@@ -241,11 +404,286 @@ std::vector<MCTS::ActionCandidate> ZeroActor::calculateMuZeroActionPolicy(MCTSNo
     return action_candidates;
 }
 
-Environment ZeroActor::getEnvironmentTransition(const std::vector<MCTSNode*>& node_path)
+utils::Rotation ZeroActor::getFeatureRotation() const
+{
+    return config::actor_use_random_rotation_features ? static_cast<utils::Rotation>(utils::Random::randInt() % static_cast<int>(utils::Rotation::kRotateSize)) : utils::Rotation::kRotationNone;
+}
+
+bool ZeroActor::pushBackSimulation(MCTSSimulation& simulation, int thread_id, bool allow_transposition)
+{
+    if (muzero_network_) {
+        simulation.feature_rotation_ = utils::Rotation::kRotationNone;
+        simulation.nn_evaluation_batch_id_ = pushBackNetworkInput(simulation.node_path_, env_, simulation.feature_rotation_);
+        return true;
+    }
+
+    // the leaf position is played only once, everything needed by the backup is kept in the simulation
+    assert(alphazero_network_);
+    const Environment& env_transition = playNodePath(simulation, thread_id);
+    simulation.reward_ = env_transition.getReward();
+    simulation.cached_output_ = nullptr;
+    bool is_evaluated = false;
+    if (env_transition.isTerminal()) {
+        evaluateTerminalLeaf(simulation, env_transition.getEvalScore());
+        is_evaluated = true;
+    } else {
+        is_evaluated = (allow_transposition && useTransposition() && evaluateByTransposition(simulation));
+    }
+    if (!is_evaluated) {
+        simulation.legal_actions_.clear();
+        for (int action_id = 0; action_id < env_transition.getPolicySize(); ++action_id) {
+            Action action(action_id, env_transition.getTurn());
+            if (env_transition.isLegalAction(action)) { simulation.legal_actions_.push_back(action); }
+        }
+        if (evaluation_cache_) {
+            std::vector<float> features;
+            is_evaluated = lookupEvaluationCache(simulation, env_transition, features);
+            if (!is_evaluated) { simulation.nn_evaluation_batch_id_ = pushBackNetworkInput(std::move(features)); }
+        } else {
+            simulation.feature_rotation_ = getFeatureRotation();
+            simulation.nn_evaluation_batch_id_ = pushBackNetworkInput(simulation.node_path_, env_transition, simulation.feature_rotation_);
+        }
+    }
+    undoNodePath(simulation, thread_id);
+    return !is_evaluated;
+}
+
+int ZeroActor::pushBackNetworkInput(const std::vector<MCTSNode*>& node_path, const Environment& env_transition, utils::Rotation feature_rotation)
+{
+    utils::ScopedStageTimer timer(utils::TimeProfiler::Stage::kFeatureExtraction);
+    if (alphazero_network_) {
+        if (inference_service_) { return pushBackPendingOutput(inference_service_->forward(env_transition.getFeatures(feature_rotation))); }
+        return alphazero_network_->pushBack(env_transition.getFeatures(feature_rotation));
+    }
+
+    assert(muzero_network_);
+    if (getMCTS()->getNumSimulation() == 0) { // initial inference for root node
+        if (inference_service_) { return pushBackPendingOutput(inference_service_->forward(env_.getFeatures())); }
+        return muzero_network_->pushBackInitialData(env_.getFeatures());
+    }
+    MCTSNode* leaf_node = node_path.back();
+    MCTSNode* parent_node = node_path[node_path.size() - 2];
+    assert(parent_node && parent_node->getHiddenStateDataIndex() != -1);
+    const HiddenStateSlab& hidden_state_data = getMCTS()->getTreeHiddenStateData();
+    torch::ScalarType hidden_state_type = torch::kFloat;
+    if (hidden_state_data.getPrecision() == HiddenStateSlab::Precision::kHalf) {
+        hidden_state_type = torch::kHalf;
+    } else if (hidden_state_data.getPrecision() == HiddenStateSlab::Precision::kBFloat16) {
+        hidden_state_type = torch::kBFloat16;
+    }
+    if (inference_service_) { return pushBackPendingOutput(inference_service_->recurrentInference(hidden_state_data.getHiddenState(parent_node->getHiddenStateDataIndex()), hidden_state_type, env_.getActionFeatures(leaf_node->getAction()))); }
+    return muzero_network_->pushBackRecurrentData(hidden_state_data.getHiddenState(parent_node->getHiddenStateDataIndex()), hidden_state_type, env_.getActionFeatures(leaf_node->getAction()));
+}
+
+int ZeroActor::pushBackNetworkInput(std::vector<float> features)
+{
+    utils::ScopedStageTimer timer(utils::TimeProfiler::Stage::kFeatureExtraction);
+    assert(alphazero_network_);
+    if (inference_service_) { return pushBackPendingOutput(inference_service_->forward(std::move(features))); }
+    return alphazero_network_->pushBack(std::move(features));
+}
+
+int ZeroActor::pushBackPendingOutput(std::future<std::shared_ptr<NetworkOutput>> pending_output)
+{
+    // the leaves of a batch are pushed by all threads of SearchParalleler
+    std::lock_guard<std::mutex> lock(pending_outputs_mutex_);
+    pending_outputs_.push_back(std::move(pending_output));
+    return pending_outputs_.size() - 1;
+}
+
+std::vector<std::shared_ptr<NetworkOutput>> ZeroActor::forwardNetwork(bool is_initial_inference)
+{
+    if (inference_service_) { return waitNetworkOutputs(); }
+    if (alphazero_network_) { return alphazero_network_->forward(); }
+    return (is_initial_inference ? muzero_network_->initialInference() : muzero_network_->recurrentInference());
+}
+
+std::vector<std::shared_ptr<NetworkOutput>> ZeroActor::waitNetworkOutputs()
+{
+    std::vector<std::shared_ptr<NetworkOutput>> network_outputs;
+    for (auto& pending_output : pending_outputs_) { network_outputs.push_back(pending_output.get()); }
+    pending_outputs_.clear();
+    return network_outputs;
+}
+
+void ZeroActor::expandAndBackup(const MCTSSimulation& simulation, const std::shared_ptr<NetworkOutput>& network_output)
 {
-    Environment env = env_;
-    for (size_t i = 1; i < node_path.size(); ++i) { env.act(node_path[i]->getAction()); }
+    utils::ScopedStageTimer timer(utils::TimeProfiler::Stage::kExpansionBackup);
+    const std::vector<MCTSNode*>& node_path = simulation.node_path_;
+    MCTSNode* leaf_node = node_path.back();
+    if (alphazero_network_) {
+        std::vector<TranspositionEntry*> transpositions = getMCTS()->findTranspositions(simulation.position_keys_);
+        std::shared_ptr<AlphaZeroNetworkOutput> alphazero_output = std::static_pointer_cast<AlphaZeroNetworkOutput>(network_output);
+        if (evaluation_cache_ && network_output != simulation.cached_output_) { evaluation_cache_->store(simulation.evaluation_key_, *alphazero_output); }
+        const bool lazy_expansion = (leaf_node != getMCTS()->getRootNode()); // the root always has all children
+        if (transpositions.empty()) {
+            getMCTS()->expand(leaf_node, calculateAlphaZeroActionPolicy(simulation.legal_actions_, alphazero_output, simulation.feature_rotation_), lazy_expansion);
+        } else if (transpositions.back()) { // the position is expanded by another node evaluated in the same batch
+            getMCTS()->shareChildren(leaf_node, transpositions.back()->node_);
+        } else if (getMCTS()->expand(leaf_node, calculateAlphaZeroActionPolicy(simulation.legal_actions_, alphazero_output, simulation.feature_rotation_), lazy_expansion)) {
+            // only published children are shared through the entry
+            transpositions.back() = getMCTS()->addTransposition(simulation.position_keys_.back(), leaf_node);
+        }
+        getMCTS()->backup(node_path, alphazero_output->value_, simulation.reward_, transpositions);
+    } else if (muzero_network_) {
+        std::shared_ptr<MuZeroNetworkOutput> muzero_output = std::static_pointer_cast<MuZeroNetworkOutput>(network_output);
+        getMCTS()->expand(leaf_node, calculateMuZeroActionPolicy(leaf_node, muzero_output));
+        getMCTS()->backup(node_path, muzero_output->value_, muzero_output->reward_);
+        leaf_node->setHiddenStateDataIndex(getMCTS()->getTreeHiddenStateData().store(muzero_output->hidden_state_));
+    } else {
+        assert(false);
+    }
+    if (leaf_node == getMCTS()->getRootNode() && !is_fast_search_) { addNoiseToNodeChildren(leaf_node); }
+}
+
+Environment& ZeroActor::playNodePath(MCTSSimulation& simulation, int thread_id)
+{
+    // environments without undo are copied from env_ for every simulation instead
+    assert(thread_id >= 0 && thread_id < static_cast<int>(search_envs_.size()));
+    Environment& env = search_envs_[thread_id];
+    if (!env.supportUndo()) { env = env_; }
+    assert(env.getActionHistory().size() == env_.getActionHistory().size());
+
+    simulation.position_keys_.clear();
+    if (useTransposition()) { simulation.position_keys_.push_back(getPositionKey(env)); }
+    for (size_t i = 1; i < simulation.node_path_.size(); ++i) {
+        env.act(simulation.node_path_[i]->getAction());
+        if (useTransposition()) { simulation.position_keys_.push_back(getPositionKey(env)); }
+    }
     return env;
 }
 
+void ZeroActor::undoNodePath(const MCTSSimulation& simulation, int thread_id)
+{
+    Environment& env = search_envs_[thread_id];
+    if (!env.supportUndo()) { return; }
+    for (size_t i = 1; i < simulation.node_path_.size(); ++i) { env.undo(); }
+}
+
+uint64_t ZeroActor::getPositionKey(const Environment& env) const
+{
+    // the turn and the move number are part of the key, so a position never transposes into its ancestors and the search graph stays acyclic
+    return env.getHashKey() ^ utils::mixHashKey((static_cast<uint64_t>(env.getActionHistory().size()) << 2) | static_cast<uint64_t>(env.getTurn()));
+}
+
+bool ZeroActor::evaluateByTransposition(const MCTSSimulation& simulation)
+{
+    // a leaf node whose position is already expanded shares its children, and is evaluated by its mean without the network
+    MCTSNode* leaf_node = simulation.node_path_.back();
+    TranspositionEntry* transposition = getMCTS()->findTransposition(simulation.position_keys_.back());
+    if (!transposition) { return false; }
+
+    std::vector<TranspositionEntry*> transpositions = getMCTS()->findTranspositions(simulation.position_keys_);
+    transpositions.back() = nullptr; // the leaf node only takes the value, the position itself is not visited
+    getMCTS()->shareChildren(leaf_node, transposition->node_);
+    getMCTS()->backup(simulation.node_path_, transposition->getMean(), simulation.reward_, transpositions);
+    return true;
+}
+
+bool ZeroActor::isBestActionDecided(int num_searched_simulation, float spent_second, float time_limit) const
+{
+    // the action is selected by the maximum count, so it is decided once the second can no longer catch up with the remaining simulations
+    if (config::actor_use_gumbel || !config::actor_select_action_by_count) { return false; }
+    const MCTSNode* root = getMCTS()->getRootNode();
+    if (!root->isLeaf() && root->getNumChildren() == 1) { return true; } // a forced action
+    int num_simulation_left = getNumSimulationLimit() + 1 - getMCTS()->getNumSimulation();
+    if (time_limit > 0 && spent_second > 0) {
+        const float simulation_per_second = num_searched_simulation / spent_second;
+        num_simulation_left = std::min(num_simulation_left, static_cast<int>(std::ceil(simulation_per_second * std::max(0.0f, time_limit - spent_second))));
+    }
+    const std::pair<int, int> counts = getTopTwoRootChildCounts();
+    return counts.first - counts.second > num_simulation_left;
+}
+
+bool ZeroActor::isBestActionClose() const
+{
+    const float kCloseCountRatio = 0.9f;
+    const std::pair<int, int> counts = getTopTwoRootChildCounts();
+    return counts.second > 0 && counts.second >= kCloseCountRatio * counts.first;
+}
+
+std::pair<int, int> ZeroActor::getTopTwoRootChildCounts() const
+{
+    std::pair<int, int> counts{0, 0};
+    const MCTSNode* root = getMCTS()->getRootNode();
+    if (root->isLeaf()) { return counts; }
+    for (const MCTSNode* child : root->getChildren()) {
+        const int count = child->getCount();
+        if (count > counts.first) {
+            counts = {count, counts.first};
+        } else if (count > counts.second) {
+            counts.second = count;
+        }
+    }
+    return counts;
+}
+
+void ZeroActor::evaluateTerminalLeaf(const MCTSSimulation& simulation, float eval_score)
+{
+    // a terminal leaf is backed up with its score on the CPU instead of taking a network slot, and is never expanded
+    std::vector<TranspositionEntry*> transpositions = getMCTS()->findTranspositions(simulation.position_keys_);
+    if (!transpositions.empty()) { transpositions.back() = nullptr; }
+    getMCTS()->backup(simulation.node_path_, eval_score, simulation.reward_, transpositions);
+    ++num_game_terminal_leaves_;
+    if (config::actor_mcts_solver) {
+        MCTSNode* leaf_node = simulation.node_path_.back();
+        leaf_node->setProof(MCTSNode::getTerminalProof(eval_score, leaf_node->getAction().getPlayer()));
+        getMCTS()->proveNodePath(simulation.node_path_);
+    }
+}
+
+bool ZeroActor::lookupEvaluationCache(MCTSSimulation& simulation, const Environment& env_transition, std::vector<float>& features)
+{
+    // the position is evaluated in the rotation of its key, so that all rotations of it share the same network output
+    {
+        utils::ScopedStageTimer timer(utils::TimeProfiler::Stage::kFeatureExtraction);
+        features = env_transition.getFeatures();
+        std::pair<uint64_t, utils::Rotation> key = evaluation_cache_->getKey(features);
+        simulation.evaluation_key_ = key.first;
+        simulation.feature_rotation_ = key.second;
+    }
+    std::shared_ptr<AlphaZeroNetworkOutput> output = std::make_shared<AlphaZeroNetworkOutput>(evaluation_cache_->getPolicySize());
+    if (!evaluation_cache_->lookup(simulation.evaluation_key_, *output)) {
+        // on a miss, the features extracted for the key are reused as the network input
+        utils::ScopedStageTimer timer(utils::TimeProfiler::Stage::kFeatureExtraction);
+        if (simulation.feature_rotation_ != utils::Rotation::kRotationNone) { features = evaluation_cache_->rotateFeatures(features, simulation.feature_rotation_); }
+        return false;
+    }
+    simulation.cached_output_ = output;
+    ++num_cache_hits_;
+    return true;
+}
+
+void ZeroActor::followPlayedAction()
+{
+    // the tree is only moved in the next resetSearch(), so the search results stay valid until then
+    if (!config::actor_mcts_reuse_tree || config::actor_use_gumbel || !reuse_node_) { return; }
+    const Action& action = env_.getActionHistory().back();
+    MCTSNode* next_node = nullptr;
+    for (MCTSNode* child : reuse_node_->getChildren()) {
+        if (child->getAction().getActionID() != action.getActionID() || child->getAction().getPlayer() != action.getPlayer()) { continue; }
+        next_node = child;
+        break;
+    }
+    reuse_node_ = (next_node && !next_node->isLeaf() ? next_node : nullptr);
+    if (is_pondered_) {
+        is_pondered_ = false;
+        num_ponder_saved_visits_ = (reuse_node_ ? reuse_node_->getCount() - ponder_root_counts_[action.getActionID()] : 0);
+    }
+}
+
+bool ZeroActor::reuseSubtree()
+{
+    if (!reuse_node_ || reuse_node_ == getMCTS()->getRootNode()) { return false; }
+    if (env_.isTerminal() || reuse_node_->getChild(0)->getAction().getPlayer() != env_.getTurn()) { return false; }
+
+    nn_evaluation_batch_id_ = -1;
+    getMCTS()->moveSubtreeToRoot(reuse_node_, [this](const MCTSNode* child) { return child->isRest() || env_.isLegalAction(child->getAction()); });
+    MCTSNode* root = getMCTS()->getRootNode();
+    if (root->isLeaf()) { return false; }
+    getMCTS()->widen(root, true); // the root always has all children
+    if (!is_fast_search_) { addNoiseToNodeChildren(root); }
+    return true;
+}
+
 } // namespace minizero::actor
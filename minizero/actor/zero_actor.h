@@ -2,10 +2,16 @@
 
 #include "alphazero_network.h"
 #include "base_actor.h"
+#include "evaluation_cache.h"
 #include "gumbel_zero.h"
 #include "mcts.h"
 #include "muzero_network.h"
+#include "search_paralleler.h"
+#include "time_profiler.h"
+#include <atomic>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -16,57 +22,160 @@ namespace minizero::actor {
 class MCTSSearchData {
 public:
     std::string search_info_;
+    int num_reused_visits_;
     MCTSNode* selected_node_;
-    std::vector<MCTSNode*> node_path_;
+    MCTSSimulation simulation_;
     void clear();
 };
 
 class ZeroActor : public BaseActor {
 public:
-    ZeroActor(uint64_t tree_node_size)
-        : tree_node_size_(tree_node_size)
+    ZeroActor(uint64_t tree_node_size, std::shared_ptr<TreeNodePool> tree_node_pool = nullptr, std::shared_ptr<EvaluationCache> evaluation_cache = nullptr)
+        : tree_node_size_(tree_node_size),
+          tree_node_pool_(tree_node_pool),
+          evaluation_cache_(evaluation_cache),
+          num_searched_moves_(0),
+          total_tree_nodes_(0),
+          peak_tree_nodes_(0),
+          is_fast_search_(false),
+          is_pondering_(false),
+          is_pondered_(false),
+          num_pondered_visits_(0),
+          num_ponder_saved_visits_(0),
+          think_time_limit_(0),
+          max_think_time_limit_(0),
+          num_network_batches_(0),
+          num_network_evaluations_(0),
+          num_wasted_slots_(0),
+          num_duplicate_leaves_(0),
+          num_game_terminal_leaves_(0),
+          num_search_start_terminal_leaves_(0),
+          num_cache_hits_(0),
+          reuse_node_(nullptr),
+          search_paralleler_(nullptr)
     {
         alphazero_network_ = nullptr;
         muzero_network_ = nullptr;
     }
 
     void reset() override;
-    void resetSearch() override;
+    void resetSearch() override { resetSearch(false); }
+    // is_fast_search is the playout cap randomization of self-play, see resetSelfPlaySearch()
+    void resetSearch(bool is_fast_search);
+    void resetSelfPlaySearch();
+    bool act(const Action& action) override;
+    bool act(const std::vector<std::string>& action_string_args) override;
     Action think(bool with_play = false, bool display_board = false) override;
+    void ponder(const std::atomic<bool>& stop_ponder, int num_simulation) override;
+    void setThinkTimeLimit(float time_limit, float max_time_limit) override
+    {
+        think_time_limit_ = time_limit;
+        max_think_time_limit_ = std::max(time_limit, max_time_limit);
+    }
     void beforeNNEvaluation() override;
     void afterNNEvaluation(const std::shared_ptr<network::NetworkOutput>& network_output) override;
-    bool isSearchDone() const override { return getMCTS()->reachMaximumSimulation(); }
+    bool isSearchDone() const override { return getMCTS()->reachMaximumSimulation(getNumSimulationLimit()) || (config::actor_mcts_solver && getMCTS()->getRootNode()->isProven()); }
     Action getSearchAction() const override { return mcts_search_data_.selected_node_->getAction(); }
     bool isResign() const override { return enable_resign_ && getMCTS()->isResign(mcts_search_data_.selected_node_); }
     std::string getSearchInfo() const override { return mcts_search_data_.search_info_; }
+    inline int getNumSearchedSimulations() const { return getMCTS()->getNumSimulation() - mcts_search_data_.num_reused_visits_; } // excluding the visits reused from the last search
     void setNetwork(const std::shared_ptr<network::Network>& network) override;
-    std::shared_ptr<Search> createSearch() override { return std::make_shared<MCTS>(tree_node_size_); }
+    void setInferenceService(const std::shared_ptr<network::InferenceService>& inference_service) override { inference_service_ = inference_service; }
+    std::shared_ptr<network::NetworkOutput> getNNEvaluationOutput() override { return waitNetworkOutputs()[nn_evaluation_batch_id_]; }
+    std::shared_ptr<Search> createSearch() override { return std::make_shared<MCTS>(tree_node_size_, tree_node_pool_); }
     std::shared_ptr<MCTS> getMCTS() { return std::static_pointer_cast<MCTS>(search_); }
     const std::shared_ptr<MCTS> getMCTS() const { return std::static_pointer_cast<MCTS>(search_); }
 
+    // called by the threads of SearchParalleler
+    void selectSimulation(MCTSSimulation& simulation, int thread_id);
+    void backupSimulation(const MCTSSimulation& simulation, const std::shared_ptr<network::NetworkOutput>& network_output);
+
 protected:
     std::vector<std::pair<std::string, std::string>> getActionInfo() const override;
     std::string getMCTSPolicy() const override { return (config::actor_use_gumbel ? gumbel_zero_.getMCTSPolicy(getMCTS()) : getMCTS()->getSearchDistributionString()); }
     std::string getMCTSValue() const override { return std::to_string(getMCTS()->getRootNode()->getMean()); }
     std::string getEnvReward() const override;
+    bool isPolicyTarget() const override { return !is_fast_search_; }
+
+    // playout cap randomization: a fast search has fewer simulations and no noise, and is not a policy training target
+    // reference: Wu, Accelerating Self-Play Learning in Go, 2019
+    inline int getNumSimulationLimit() const { return (is_fast_search_ ? config::actor_playout_cap_fast_num_simulation : config::actor_num_simulation); }
 
     virtual void step();
+    virtual void parallelStep(int batch_size);
+    inline void countNetworkEvaluations(int num_evaluations, int batch_size)
+    {
+        ++num_network_batches_;
+        num_network_evaluations_ += num_evaluations;
+        num_wasted_slots_ += batch_size - num_evaluations;
+    }
     virtual void handleSearchDone();
     virtual MCTSNode* decideActionNode();
     virtual void addNoiseToNodeChildren(MCTSNode* node);
-    virtual std::vector<MCTSNode*> selection() { return (config::actor_use_gumbel ? gumbel_zero_.selection(getMCTS()) : getMCTS()->select()); }
+    virtual std::vector<MCTSNode*> selection()
+    {
+        utils::ScopedStageTimer timer(utils::TimeProfiler::Stage::kSelection);
+        return (config::actor_use_gumbel ? gumbel_zero_.selection(getMCTS()) : getMCTS()->select());
+    }
 
-    std::vector<MCTS::ActionCandidate> calculateAlphaZeroActionPolicy(const Environment& env_transition, const std::shared_ptr<network::AlphaZeroNetworkOutput>& alphazero_output, const utils::Rotation& rotation);
+    std::vector<MCTS::ActionCandidate> calculateAlphaZeroActionPolicy(const std::vector<Action>& legal_actions, const std::shared_ptr<network::AlphaZeroNetworkOutput>& alphazero_output, const utils::Rotation& rotation);
     std::vector<MCTS::ActionCandidate> calculateMuZeroActionPolicy(MCTSNode* leaf_node, const std::shared_ptr<network::MuZeroNetworkOutput>& muzero_output);
-    virtual Environment getEnvironmentTransition(const std::vector<MCTSNode*>& node_path);
+    virtual utils::Rotation getFeatureRotation() const;
+    virtual bool pushBackSimulation(MCTSSimulation& simulation, int thread_id, bool allow_transposition);
+    virtual int pushBackNetworkInput(const std::vector<MCTSNode*>& node_path, const Environment& env_transition, utils::Rotation feature_rotation);
+    virtual int pushBackNetworkInput(std::vector<float> features); // the features of an alphazero leaf already extracted
+    int pushBackPendingOutput(std::future<std::shared_ptr<network::NetworkOutput>> pending_output);
+    std::vector<std::shared_ptr<network::NetworkOutput>> forwardNetwork(bool is_initial_inference);
+    std::vector<std::shared_ptr<network::NetworkOutput>> waitNetworkOutputs();
+    virtual void expandAndBackup(const MCTSSimulation& simulation, const std::shared_ptr<network::NetworkOutput>& network_output);
+    virtual Environment& playNodePath(MCTSSimulation& simulation, int thread_id);
+    virtual void undoNodePath(const MCTSSimulation& simulation, int thread_id);
+    virtual uint64_t getPositionKey(const Environment& env) const;
+    virtual bool evaluateByTransposition(const MCTSSimulation& simulation);
+    virtual void evaluateTerminalLeaf(const MCTSSimulation& simulation, float eval_score);
+    virtual bool lookupEvaluationCache(MCTSSimulation& simulation, const Environment& env_transition, std::vector<float>& features);
+    inline bool useTransposition() const { return config::actor_mcts_use_transposition && alphazero_network_ && env_.supportHashKey(); }
+    // the batch is searched by several threads once the root node is expanded
+    inline bool useParallelSearch() const { return config::actor_mcts_think_num_threads > 1 && !config::actor_use_gumbel && !getMCTS()->getRootNode()->isLeaf(); }
+    virtual bool isBestActionDecided(int num_searched_simulation, float spent_second, float time_limit) const;
+    virtual bool isBestActionClose() const;
+    std::pair<int, int> getTopTwoRootChildCounts() const;
+    virtual void followPlayedAction();
+    virtual bool reuseSubtree();
 
     bool enable_resign_;
     GumbelZero gumbel_zero_;
     uint64_t tree_node_size_;
+    std::shared_ptr<TreeNodePool> tree_node_pool_;
+    std::shared_ptr<EvaluationCache> evaluation_cache_; // shared by all actors, only for alphazero
+    uint64_t num_searched_moves_; // the tree nodes allocated by the searches of all moves, for sizing the memory of actors
+    uint64_t total_tree_nodes_;
+    uint64_t peak_tree_nodes_;
+    bool is_fast_search_;
+    bool is_pondering_;
+    bool is_pondered_;                                // the tree is searched from the opponent's turn by ponder()
+    int num_pondered_visits_;                         // the visits added by ponder() since the last think()
+    int num_ponder_saved_visits_;                     // the pondered visits in the subtree of the opponent's actual action
+    std::unordered_map<int, int> ponder_root_counts_; // the counts of the root children before pondering, by action ID
+    float think_time_limit_;
+    float max_think_time_limit_;
+    // the network batches of a search, where the slots are wasted by duplicate leaves, transpositions, cached evaluations, or the search ending
+    int num_network_batches_;
+    int num_network_evaluations_;
+    int num_wasted_slots_;
+    int num_duplicate_leaves_;
+    std::atomic<int> num_game_terminal_leaves_; // the network evaluations saved by terminal leaves in the current game
+    int num_search_start_terminal_leaves_;
+    std::atomic<int> num_cache_hits_; // the network evaluations saved by the evaluation cache in the current search
     MCTSSearchData mcts_search_data_;
-    utils::Rotation feature_rotation_;
+    MCTSNode* reuse_node_; // the node of the current tree that corresponds to env_, used by actor_mcts_reuse_tree
+    std::vector<Environment> search_envs_; // one per search thread, node paths are played on them from env_
+    std::shared_ptr<SearchParalleler> search_paralleler_;
     std::shared_ptr<network::AlphaZeroNetwork> alphazero_network_;
     std::shared_ptr<network::MuZeroNetwork> muzero_network_;
+    std::shared_ptr<network::InferenceService> inference_service_;
+    std::mutex pending_outputs_mutex_;
+    std::vector<std::future<std::shared_ptr<network::NetworkOutput>>> pending_outputs_; // the evaluations submitted to the inference service, by batch index
 };
 
 } // namespace minizero::actor
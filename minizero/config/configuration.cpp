@@ -14,7 +14,27 @@ float actor_mcts_puct_base = 19652;
 float actor_mcts_puct_init = 1.25;
 float actor_mcts_reward_discount = 1.0f;
 int actor_mcts_think_batch_size = 1;
+int actor_mcts_think_batch_refill = 0;
+int actor_mcts_think_num_threads = 1;
 float actor_mcts_think_time_limit = 0;
+float actor_mcts_think_time_extension = 0;
+float actor_mcts_think_time_margin = 0.5f;
+int actor_mcts_think_moves_to_go = 30;
+bool actor_mcts_think_early_stop = false;
+bool actor_mcts_reuse_tree = false;
+bool actor_mcts_ponder = false;
+int actor_mcts_ponder_num_simulation = 0;
+bool actor_mcts_use_transposition = false;
+int actor_mcts_evaluation_cache_size = 0;
+bool actor_mcts_solver = false;
+int actor_mcts_expand_top_k = 0;
+float actor_mcts_widening_factor = 1.0f;
+float actor_mcts_widening_exponent = 0.5f;
+std::string actor_tree_huge_page = "none";
+std::string actor_mcts_hidden_state_precision = "fp32";
+bool actor_use_inference_service = false;
+int actor_inference_service_max_batch_size = 64;
+int actor_inference_service_max_wait_microseconds = 1000;
 bool actor_mcts_value_rescale = false;
 bool actor_select_action_by_count = false;
 bool actor_select_action_by_softmax_count = true;
@@ -30,6 +50,8 @@ int actor_gumbel_sample_size = 16;
 float actor_gumbel_sigma_visit_c = 50;
 float actor_gumbel_sigma_scale_c = 1;
 float actor_resign_threshold = -0.9f;
+float actor_playout_cap_fast_ratio = 0.0f;
+int actor_playout_cap_fast_num_simulation = 10;
 
 // zero parameters
 int zero_num_threads = 4;
@@ -43,7 +65,13 @@ int zero_replay_buffer = 20;
 float zero_disable_resign_ratio = 0.1;
 int zero_actor_intermediate_sequence_length = 0;
 std::string zero_actor_ignored_command = "reset_actors";
+int zero_actor_num_cohorts = 1;
+std::string zero_actor_thread_affinity = "none";
+std::string zero_actor_inference_cpus = "";
 bool zero_server_accept_different_model_games = true;
+int zero_num_reanalyse_games_per_iteration = 0;
+int zero_benchmark_num_moves = 0;
+int zero_benchmark_num_seconds = 60;
 
 // learner parameters
 bool learner_use_per = false;
@@ -92,7 +120,27 @@ void setConfiguration(ConfigureLoader& cl)
     cl.addParameter("actor_mcts_reward_discount", actor_mcts_reward_discount, "discount factor for calculating Q values", "Actor");                                           // ref: MZ, Sec. Methods
     cl.addParameter("actor_mcts_value_rescale", actor_mcts_value_rescale, "true for games whose rewards are not bounded in [-1, 1], e.g., Atari games", "Actor");             // ref: MZ
     cl.addParameter("actor_mcts_think_batch_size", actor_mcts_think_batch_size, "the MCTS selection batch size; only works when running console", "Actor");
+    cl.addParameter("actor_mcts_think_batch_refill", actor_mcts_think_batch_refill, "the number of extra selections per batch to refill the slots of selections reaching a leaf already in the batch; only works when running console with actor_mcts_think_num_threads = 1", "Actor");
+    cl.addParameter("actor_mcts_think_num_threads", actor_mcts_think_num_threads, "the number of threads searching the same tree for a batch; only works when running console, and not for gumbel", "Actor");
     cl.addParameter("actor_mcts_think_time_limit", actor_mcts_think_time_limit, "the MCTS time limit in seconds, 0 represents disabling time limit (only uses actor_num_simulation); only works when running console", "Actor");
+    cl.addParameter("actor_mcts_think_time_extension", actor_mcts_think_time_extension, "the maximum extension of the time limit as a multiple of it, used while the two most visited root children are close; only works when running console", "Actor");
+    cl.addParameter("actor_mcts_think_time_margin", actor_mcts_think_time_margin, "the seconds kept from every time limit given by the GTP time_settings/time_left clock, for the lag between the controller and the search", "Actor");
+    cl.addParameter("actor_mcts_think_moves_to_go", actor_mcts_think_moves_to_go, "the number of moves the remaining main time of the GTP clock is shared by", "Actor");
+    cl.addParameter("actor_mcts_think_early_stop", actor_mcts_think_early_stop, "true for stopping the search once the second most visited root child can no longer catch up the most visited one within the remaining simulations and time; only works with actor_select_action_by_count when running console", "Actor");
+    cl.addParameter("actor_mcts_reuse_tree", actor_mcts_reuse_tree, "true for reusing the subtree of the played actions as the search tree of the next move; not supported with actor_use_gumbel", "Actor");
+    cl.addParameter("actor_mcts_ponder", actor_mcts_ponder, "true for searching the opponent's turn in the background after genmove, so that the subtree of the actual reply is reused; requires actor_mcts_reuse_tree; only works when running console", "Actor");
+    cl.addParameter("actor_mcts_ponder_num_simulation", actor_mcts_ponder_num_simulation, "the maximum number of simulations pondered per opponent's turn, 0 represents pondering until the tree reaches actor_num_simulation; only works when running console", "Actor");
+    cl.addParameter("actor_mcts_use_transposition", actor_mcts_use_transposition, "true for sharing the search statistics of transposed positions (the same position reached by different move orders); only for alphazero and environments providing a hash key", "Actor");
+    cl.addParameter("actor_mcts_evaluation_cache_size", actor_mcts_evaluation_cache_size, "the number of network outputs cached for the positions evaluated by all actors and moves, cleared when the model is reloaded; 0 represents disabling the cache; an entry takes about 2 bytes per action; only for alphazero", "Actor");
+    cl.addParameter("actor_mcts_solver", actor_mcts_solver, "true for proving wins, losses and draws from terminal positions (MCTS-solver), so that proven subtrees are no longer searched, a proven win is played at once, and the search stops once the root is proven; only for alphazero, and losses and draws are only proven without actor_mcts_expand_top_k", "Actor");
+    cl.addParameter("actor_mcts_expand_top_k", actor_mcts_expand_top_k, "the number of children allocated when expanding a non-root node, and when widening it; 0 represents allocating all children; only for alphazero", "Actor");
+    cl.addParameter("actor_mcts_widening_factor", actor_mcts_widening_factor, "C of progressive widening, a node with N visits is widened to ceil(C * N^alpha) children; only works with actor_mcts_expand_top_k", "Actor");
+    cl.addParameter("actor_mcts_widening_exponent", actor_mcts_widening_exponent, "alpha of progressive widening; only works with actor_mcts_expand_top_k", "Actor");
+    cl.addParameter("actor_tree_huge_page", actor_tree_huge_page, "huge pages for the tree nodes of actors: none, transparent (madvise), or explicit (MAP_HUGETLB, which reserves twice the worst-case tree size of all actors in vm.nr_hugepages, otherwise falls back to transparent)", "Actor");
+    cl.addParameter("actor_mcts_hidden_state_precision", actor_mcts_hidden_state_precision, "storage of MuZero hidden states in the search tree: fp32, fp16, or bf16; converted back to float on the network device", "Actor");
+    cl.addParameter("actor_use_inference_service", actor_use_inference_service, "true for evaluating the leaves of all searches sharing a network by an inference service thread, which forms the batches as the leaves arrive instead of one batch per phase or per think batch", "Actor");
+    cl.addParameter("actor_inference_service_max_batch_size", actor_inference_service_max_batch_size, "the maximum batch size of the inference service", "Actor");
+    cl.addParameter("actor_inference_service_max_wait_microseconds", actor_inference_service_max_wait_microseconds, "the maximum time the first leaf of a batch waits for the batch to fill before the inference service evaluates it", "Actor");
     cl.addParameter("actor_select_action_by_count", actor_select_action_by_count, "true for selecting the action by the maximum MCTS count; should not be true together with actor_select_action_by_softmax_count", "Actor");
     cl.addParameter("actor_select_action_by_softmax_count", actor_select_action_by_softmax_count, "true for selecting the action by the propotion of MCTS count; should not be true together with actor_select_action_by_count", "Actor");
     cl.addParameter("actor_select_action_softmax_temperature", actor_select_action_softmax_temperature, "the softmax temperature when using actor_select_action_by_softmax_count", "Actor");
@@ -107,6 +155,8 @@ void setConfiguration(ConfigureLoader& cl)
     cl.addParameter("actor_gumbel_sigma_visit_c", actor_gumbel_sigma_visit_c, "hyperparameter for the monotonically increasing transformation sigma in Gumbel Zero", "Actor"); // ref: GZ, Sec. 3.4
     cl.addParameter("actor_gumbel_sigma_scale_c", actor_gumbel_sigma_scale_c, "hyperparameter for the monotonically increasing transformation sigma in Gumbel Zero", "Actor"); // ref: GZ, Sec. 3.4
     cl.addParameter("actor_resign_threshold", actor_resign_threshold, "the threshold determining when to resign in the actor", "Actor");                                       // ref: AG, Sec. Methods
+    cl.addParameter("actor_playout_cap_fast_ratio", actor_playout_cap_fast_ratio, "the probability of a self-play move searched by actor_playout_cap_fast_num_simulation without noise, which is not a policy training target; 0 represents searching all moves fully; only for alphazero, and not with actor_use_gumbel", "Actor"); // ref: KG, Sec. 3.1
+    cl.addParameter("actor_playout_cap_fast_num_simulation", actor_playout_cap_fast_num_simulation, "the simulation number of the fast searches of actor_playout_cap_fast_ratio", "Actor");
 
     // zero parameters
     cl.addParameter("zero_num_threads", zero_num_threads, "the number of threads that the zero server uses for zero training", "Zero");
@@ -120,7 +170,13 @@ void setConfiguration(ConfigureLoader& cl)
     cl.addParameter("zero_disable_resign_ratio", zero_disable_resign_ratio, "the probability to keep playing when the winrate is below actor_resign_threshold", "Zero");                                                       // ref: AZ, Sec. Methods
     cl.addParameter("zero_actor_intermediate_sequence_length", zero_actor_intermediate_sequence_length, "the max sequence length when running self-play; usually 0 (unlimited) for board games, 200 for atari games", "Zero"); // ref: MZ
     cl.addParameter("zero_actor_ignored_command", zero_actor_ignored_command, "the commands to ignore by the actor; format: command1 command2 ...", "Zero");
+    cl.addParameter("zero_actor_num_cohorts", zero_actor_num_cohorts, "the number of cohorts the actors are split into; with more than one, the search of a cohort overlaps the network forward of the previous cohort, and each cohort loads its own copy of the model on every GPU", "Zero");
+    cl.addParameter("zero_actor_thread_affinity", zero_actor_thread_affinity, "the placement of the slave threads of actors: none, core (each thread pinned to a core), or node (each thread pinned to a NUMA node); when pinned, the threads are spread over the NUMA nodes, and each thread only searches the actors whose trees and environments are allocated on its node", "Zero");
+    cl.addParameter("zero_actor_inference_cpus", zero_actor_inference_cpus, "the CPUs reserved for network inference, e.g. 0-3,8; the threads forwarding the networks and their torch threads run on them, and the other slave threads do not; empty for no reservation", "Zero");
     cl.addParameter("zero_server_accept_different_model_games", zero_server_accept_different_model_games, "true for accepting self-play games generated by out-of-date model", "Zero");
+    cl.addParameter("zero_num_reanalyse_games_per_iteration", zero_num_reanalyse_games_per_iteration, "the maximum number of games of previous iterations searched again by re workers with the current model in each iteration; 0 represents disabling reanalyse", "Zero"); // ref: MZ, Appendix H
+    cl.addParameter("zero_benchmark_num_moves", zero_benchmark_num_moves, "the number of moves played by the benchmark mode, 0 for no limit; the benchmark stops at whichever limit comes first, and uses a synthetic network of uniform policy and zero value if nn_file_name is empty", "Zero");
+    cl.addParameter("zero_benchmark_num_seconds", zero_benchmark_num_seconds, "the number of seconds the benchmark mode plays, 0 for no limit", "Zero");
 
     // learner parameters
     cl.addParameter("learner_use_per", learner_use_per, "true for enabling Prioritized Experience Replay", "Learner");                                                              // ref: PER
@@ -177,6 +233,7 @@ void setConfiguration(ConfigureLoader& cl)
     // [AG] Mastering the game of Go with deep neural networks and tree search
     // [AGZ] Mastering the game of Go without human knowledge
     // [PER] Prioritized Experience Replay
+    // [KG] Accelerating Self-Play Learning in Go
 }
 
 } // namespace minizero::config
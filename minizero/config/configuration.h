@@ -17,7 +17,27 @@ extern float actor_mcts_puct_init;
 extern float actor_mcts_reward_discount;
 extern bool actor_mcts_value_rescale;
 extern int actor_mcts_think_batch_size;
+extern int actor_mcts_think_batch_refill;
+extern int actor_mcts_think_num_threads;
 extern float actor_mcts_think_time_limit;
+extern float actor_mcts_think_time_extension;
+extern float actor_mcts_think_time_margin;
+extern int actor_mcts_think_moves_to_go;
+extern bool actor_mcts_think_early_stop;
+extern bool actor_mcts_reuse_tree;
+extern bool actor_mcts_ponder;
+extern int actor_mcts_ponder_num_simulation;
+extern bool actor_mcts_use_transposition;
+extern int actor_mcts_evaluation_cache_size;
+extern bool actor_mcts_solver;
+extern int actor_mcts_expand_top_k;
+extern float actor_mcts_widening_factor;
+extern float actor_mcts_widening_exponent;
+extern std::string actor_tree_huge_page;
+extern std::string actor_mcts_hidden_state_precision;
+extern bool actor_use_inference_service;
+extern int actor_inference_service_max_batch_size;
+extern int actor_inference_service_max_wait_microseconds;
 extern bool actor_select_action_by_count;
 extern bool actor_select_action_by_softmax_count;
 extern float actor_select_action_softmax_temperature;
@@ -32,6 +52,8 @@ extern int actor_gumbel_sample_size;
 extern float actor_gumbel_sigma_visit_c;
 extern float actor_gumbel_sigma_scale_c;
 extern float actor_resign_threshold;
+extern float actor_playout_cap_fast_ratio;
+extern int actor_playout_cap_fast_num_simulation;
 
 // zero parameters
 extern int zero_num_threads;
@@ -45,7 +67,13 @@ extern int zero_replay_buffer;
 extern float zero_disable_resign_ratio;
 extern int zero_actor_intermediate_sequence_length;
 extern std::string zero_actor_ignored_command;
+extern int zero_actor_num_cohorts;
+extern std::string zero_actor_thread_affinity;
+extern std::string zero_actor_inference_cpus;
 extern bool zero_server_accept_different_model_games;
+extern int zero_num_reanalyse_games_per_iteration;
+extern int zero_benchmark_num_moves;
+extern int zero_benchmark_num_seconds;
 
 // learner parameters
 extern bool learner_use_per;
@@ -17,7 +17,11 @@ using namespace network;
 
 Console::Console()
     : network_(nullptr),
-      actor_(nullptr)
+      inference_service_(nullptr),
+      actor_(nullptr),
+      evaluation_cache_(nullptr),
+      is_opponent_turn_(false),
+      stop_ponder_(false)
 {
     RegisterFunction("gogui-analyze_commands", this, &Console::cmdGoguiAnalyzeCommands);
     RegisterFunction("list_commands", this, &Console::cmdListCommands);
@@ -33,18 +37,28 @@ Console::Console()
     RegisterFunction("final_score", this, &Console::cmdFinalScore);
     RegisterFunction("pv", this, &Console::cmdPV);
     RegisterFunction("load_model", this, &Console::cmdLoadModel);
+    RegisterFunction("ponder", this, &Console::cmdPonder);
+    RegisterFunction("ponder_limit", this, &Console::cmdPonderLimit);
+    RegisterFunction("time_settings", this, &Console::cmdTimeSettings);
+    RegisterFunction("time_left", this, &Console::cmdTimeLeft);
 }
 
 void Console::initialize()
 {
     if (!network_) { network_ = createNetwork(config::nn_file_name, 0); }
+    if (config::actor_use_inference_service && (!inference_service_ || inference_service_->getNetwork() != network_)) {
+        inference_service_ = std::make_shared<InferenceService>(network_, config::actor_inference_service_max_batch_size, config::actor_inference_service_max_wait_microseconds);
+    }
     if (!actor_) {
-        uint64_t tree_node_size = static_cast<uint64_t>(config::actor_num_simulation + 1) * network_->getActionSize();
-        actor_ = actor::createActor(tree_node_size, network_);
+        uint64_t tree_node_size = actor::getTreeNodeSize(network_);
+        evaluation_cache_ = actor::createEvaluationCache(network_);
+        actor_ = actor::createActor(tree_node_size, network_, actor::createTreeNodePool(tree_node_size, network_, 1), evaluation_cache_);
     }
     actor_->setNetwork(network_);
+    actor_->setInferenceService(inference_service_);
 
     // forward the network several times to warmup since the first few forwards requires some initialization time
+    // the inference service only uses the network for the requests of the searches, so no search is running here
     const int num_warmup_forward = 3;
     if (network_->getNetworkTypeName() == "alphazero") {
         std::shared_ptr<network::AlphaZeroNetwork> alphazero_network = std::static_pointer_cast<network::AlphaZeroNetwork>(network_);
@@ -69,6 +83,9 @@ void Console::executeCommand(std::string command)
     if (command.back() == '\r') { command.pop_back(); }
     if (command.empty()) { return; }
 
+    // every command waits for the pondering to stop, and the pondering resumes afterwards if the position is unchanged
+    stopPondering();
+
     // parse command to args
     std::stringstream ss(command);
     std::string tmp;
@@ -76,8 +93,12 @@ void Console::executeCommand(std::string command)
     while (std::getline(ss, tmp, ' ')) { args.push_back(tmp); }
 
     // execute function
-    if (function_map_.count(args[0]) == 0) { return reply(ConsoleResponse::kFail, "Unknown command: " + command); }
-    (*function_map_[args[0]])(args);
+    if (function_map_.count(args[0]) == 0) {
+        reply(ConsoleResponse::kFail, "Unknown command: " + command);
+    } else {
+        (*function_map_[args[0]])(args);
+    }
+    startPondering();
 }
 
 void Console::cmdGoguiAnalyzeCommands(const std::vector<std::string>& args)
@@ -116,7 +137,9 @@ void Console::cmdProtocalVersion(const std::vector<std::string>& args)
 void Console::cmdClearBoard(const std::vector<std::string>& args)
 {
     if (!checkArgument(args, 1, 1)) { return; }
+    is_opponent_turn_ = false;
     actor_->reset();
+    time_manager_.resetClocks();
     reply(ConsoleResponse::kSuccess, "");
 }
 
@@ -129,6 +152,7 @@ void Console::cmdShowBoard(const std::vector<std::string>& args)
 void Console::cmdPlay(const std::vector<std::string>& args)
 {
     if (!checkArgument(args, 3, INT_MAX)) { return; }
+    is_opponent_turn_ = false;
     std::string action_string = args[2];
     std::vector<std::string> act_args;
     for (unsigned int i = 1; i < args.size(); i++) { act_args.push_back(args[i]); }
@@ -139,6 +163,7 @@ void Console::cmdPlay(const std::vector<std::string>& args)
 void Console::cmdBoardSize(const std::vector<std::string>& args)
 {
     if (!checkArgument(args, 2, 2)) { return; }
+    is_opponent_turn_ = false;
     minizero::config::env_board_size = stoi(args[1]);
     initialize();
     reply(ConsoleResponse::kSuccess, "\n" + actor_->getEnvironment().toString());
@@ -148,13 +173,22 @@ void Console::cmdGenmove(const std::vector<std::string>& args)
 {
     if (!checkArgument(args, 2, 2)) { return; }
 
+    is_opponent_turn_ = false;
     if (actor_->isEnvTerminal()) { return reply(ConsoleResponse::kSuccess, "PASS"); }
-    actor_->getEnvironment().setTurn(minizero::env::charToPlayer(args[1].c_str()[0]));
+    const env::Player player = minizero::env::charToPlayer(args[1].c_str()[0]);
+    actor_->getEnvironment().setTurn(player);
+    if (time_manager_.hasTimeControl()) {
+        const std::pair<float, float> time_limit = time_manager_.getTimeLimit(player);
+        actor_->setThinkTimeLimit(time_limit.first, time_limit.second);
+    }
     boost::posix_time::ptime start_ptime = utils::TimeSystem::getLocalTime();
     const Action action = actor_->think((args[0] == "genmove" ? true : false), true);
-    std::cerr << "Spent Time = " << (utils::TimeSystem::getLocalTime() - start_ptime).total_milliseconds() / 1000.0f << " (s)" << std::endl;
+    const float spent_time = (utils::TimeSystem::getLocalTime() - start_ptime).total_milliseconds() / 1000.0f;
+    std::cerr << "Spent Time = " << spent_time << " (s)" << std::endl;
+    time_manager_.consumeTime(player, spent_time);
     if (actor_->isResign()) { return reply(ConsoleResponse::kSuccess, "Resign"); }
 
+    is_opponent_turn_ = (args[0] == "genmove");
     reply(ConsoleResponse::kSuccess, action.toConsoleString());
 }
 
@@ -208,18 +242,55 @@ void Console::cmdPV(const std::vector<std::string>& args)
 void Console::cmdLoadModel(const std::vector<std::string>& args)
 {
     if (!checkArgument(args, 2, 2)) { return; }
+    is_opponent_turn_ = false;
     minizero::config::nn_file_name = args[1];
     network_ = nullptr;
+    if (evaluation_cache_) { evaluation_cache_->clear(); } // the outputs of the previous model
     initialize();
     reply(ConsoleResponse::kSuccess, "");
 }
 
+void Console::cmdPonder(const std::vector<std::string>& args)
+{
+    if (!checkArgument(args, 2, 2)) { return; }
+    if (args[1] != "on" && args[1] != "off") { return reply(ConsoleResponse::kFail, "Invalid argument: \"" + args[1] + "\", should be on or off"); }
+    if (args[1] == "on" && (!config::actor_mcts_reuse_tree || config::actor_use_gumbel)) { return reply(ConsoleResponse::kFail, "pondering requires actor_mcts_reuse_tree and no actor_use_gumbel"); }
+    config::actor_mcts_ponder = (args[1] == "on");
+    reply(ConsoleResponse::kSuccess, "");
+}
+
+void Console::cmdPonderLimit(const std::vector<std::string>& args)
+{
+    if (!checkArgument(args, 2, 2)) { return; }
+    config::actor_mcts_ponder_num_simulation = std::max(0, stoi(args[1]));
+    reply(ConsoleResponse::kSuccess, "");
+}
+
+void Console::cmdTimeSettings(const std::vector<std::string>& args)
+{
+    if (!checkArgument(args, 4, 4)) { return; }
+    time_manager_.setTimeSettings(stof(args[1]), stof(args[2]), stoi(args[3]));
+    reply(ConsoleResponse::kSuccess, "");
+}
+
+void Console::cmdTimeLeft(const std::vector<std::string>& args)
+{
+    if (!checkArgument(args, 4, 4)) { return; }
+    time_manager_.setTimeLeft(minizero::env::charToPlayer(args[1].c_str()[0]), stof(args[2]), stoi(args[3]));
+    reply(ConsoleResponse::kSuccess, "");
+}
+
 void Console::calculatePolicyValue(std::vector<float>& policy, float& value, utils::Rotation rotation /* = utils::Rotation::kRotationNone */)
 {
     if (network_->getNetworkTypeName() == "alphazero") {
         std::shared_ptr<network::AlphaZeroNetwork> alphazero_network = std::static_pointer_cast<network::AlphaZeroNetwork>(network_);
-        int index = alphazero_network->pushBack(actor_->getEnvironment().getFeatures(rotation));
-        std::shared_ptr<NetworkOutput> network_output = alphazero_network->forward()[index];
+        std::shared_ptr<NetworkOutput> network_output;
+        if (inference_service_) {
+            network_output = inference_service_->forward(actor_->getEnvironment().getFeatures(rotation)).get();
+        } else {
+            int index = alphazero_network->pushBack(actor_->getEnvironment().getFeatures(rotation));
+            network_output = alphazero_network->forward()[index];
+        }
         std::shared_ptr<minizero::network::AlphaZeroNetworkOutput> zero_output = std::static_pointer_cast<minizero::network::AlphaZeroNetworkOutput>(network_output);
         value = zero_output->value_;
         policy.clear();
@@ -229,8 +300,13 @@ void Console::calculatePolicyValue(std::vector<float>& policy, float& value, uti
         }
     } else if (network_->getNetworkTypeName() == "muzero") {
         std::shared_ptr<network::MuZeroNetwork> muzero_network = std::static_pointer_cast<network::MuZeroNetwork>(network_);
-        int index = muzero_network->pushBackInitialData(actor_->getEnvironment().getFeatures());
-        std::shared_ptr<NetworkOutput> network_output = muzero_network->initialInference()[index];
+        std::shared_ptr<NetworkOutput> network_output;
+        if (inference_service_) {
+            network_output = inference_service_->forward(actor_->getEnvironment().getFeatures()).get();
+        } else {
+            int index = muzero_network->pushBackInitialData(actor_->getEnvironment().getFeatures());
+            network_output = muzero_network->initialInference()[index];
+        }
         std::shared_ptr<minizero::network::MuZeroNetworkOutput> zero_output = std::static_pointer_cast<minizero::network::MuZeroNetworkOutput>(network_output);
         policy = zero_output->policy_;
         value = zero_output->value_;
@@ -261,4 +337,18 @@ void Console::reply(ConsoleResponse response, const std::string& reply)
     std::cout << static_cast<char>(response) << " " << reply << "\n\n";
 }
 
+void Console::startPondering()
+{
+    if (!config::actor_mcts_ponder || !is_opponent_turn_ || actor_->isEnvTerminal()) { return; }
+    stop_ponder_ = false;
+    ponder_thread_ = boost::thread([this]() { actor_->ponder(stop_ponder_, config::actor_mcts_ponder_num_simulation); });
+}
+
+void Console::stopPondering()
+{
+    if (!ponder_thread_.joinable()) { return; }
+    stop_ponder_ = true;
+    ponder_thread_.join();
+}
+
 } // namespace minizero::console
@@ -1,7 +1,12 @@
 #pragma once
 
 #include "base_actor.h"
+#include "evaluation_cache.h"
+#include "inference_service.h"
 #include "network.h"
+#include "time_manager.h"
+#include <atomic>
+#include <boost/thread.hpp>
 #include <map>
 #include <memory>
 #include <string>
@@ -19,7 +24,7 @@ enum class ConsoleResponse : char {
 class Console {
 public:
     Console();
-    virtual ~Console() = default;
+    virtual ~Console() { stopPondering(); }
 
     virtual void initialize();
     virtual void executeCommand(std::string command);
@@ -60,14 +65,26 @@ protected:
     void cmdFinalScore(const std::vector<std::string>& args);
     void cmdPV(const std::vector<std::string>& args);
     void cmdLoadModel(const std::vector<std::string>& args);
+    void cmdPonder(const std::vector<std::string>& args);
+    void cmdPonderLimit(const std::vector<std::string>& args);
+    void cmdTimeSettings(const std::vector<std::string>& args);
+    void cmdTimeLeft(const std::vector<std::string>& args);
 
     virtual void calculatePolicyValue(std::vector<float>& policy, float& value, utils::Rotation rotation = utils::Rotation::kRotationNone);
     bool checkArgument(const std::vector<std::string>& args, int min_argc, int max_argc);
     void reply(ConsoleResponse response, const std::string& reply);
+    void startPondering();
+    void stopPondering();
 
     std::shared_ptr<minizero::network::Network> network_;
+    std::shared_ptr<minizero::network::InferenceService> inference_service_; // nullptr unless actor_use_inference_service
     std::shared_ptr<actor::BaseActor> actor_;
+    std::shared_ptr<actor::EvaluationCache> evaluation_cache_;
     std::map<std::string, std::shared_ptr<BaseFunction>> function_map_;
+    TimeManager time_manager_;
+    bool is_opponent_turn_; // our move is generated and played, so the opponent's turn can be pondered until the next command
+    std::atomic<bool> stop_ponder_;
+    boost::thread ponder_thread_;
 };
 
 } // namespace minizero::console
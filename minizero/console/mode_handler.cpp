@@ -1,9 +1,12 @@
 #include "mode_handler.h"
 #include "actor_group.h"
+#include "analysis_group.h"
+#include "benchmark_group.h"
 #include "console.h"
 #include "git_info.h"
 #include "ostream_redirector.h"
 #include "random.h"
+#include "reanalyse_group.h"
 #include "zero_server.h"
 #include <string>
 #include <vector>
@@ -16,9 +19,12 @@ ModeHandler::ModeHandler()
 {
     RegisterFunction("console", this, &ModeHandler::runConsole);
     RegisterFunction("sp", this, &ModeHandler::runSelfPlay);
+    RegisterFunction("analysis", this, &ModeHandler::runAnalysis);
+    RegisterFunction("re", this, &ModeHandler::runReanalyse);
     RegisterFunction("zero_server", this, &ModeHandler::runZeroServer);
     RegisterFunction("zero_training_name", this, &ModeHandler::runZeroTrainingName);
     RegisterFunction("env_test", this, &ModeHandler::runEnvTest);
+    RegisterFunction("benchmark", this, &ModeHandler::runBenchmark);
 }
 
 void ModeHandler::run(int argc, char* argv[])
@@ -142,6 +148,18 @@ void ModeHandler::runSelfPlay()
     ag.run();
 }
 
+void ModeHandler::runAnalysis()
+{
+    actor::AnalysisGroup ag;
+    ag.run();
+}
+
+void ModeHandler::runReanalyse()
+{
+    actor::ReanalyseGroup rg;
+    rg.run();
+}
+
 void ModeHandler::runZeroServer()
 {
     zero::ZeroServer server;
@@ -174,4 +192,10 @@ void ModeHandler::runEnvTest()
     std::cout << env_loader.toString() << std::endl;
 }
 
+void ModeHandler::runBenchmark()
+{
+    actor::BenchmarkGroup bg;
+    bg.run();
+}
+
 } // namespace minizero::console
@@ -44,9 +44,12 @@ protected:
     bool readConfiguration(config::ConfigureLoader& cl, const std::string& sConfigFile, const std::string& sConfigString);
     virtual void runConsole();
     virtual void runSelfPlay();
+    virtual void runAnalysis();
+    virtual void runReanalyse();
     virtual void runZeroServer();
     virtual void runZeroTrainingName();
     virtual void runEnvTest();
+    virtual void runBenchmark();
 
     std::map<std::string, std::shared_ptr<BaseFunction>> function_map_;
 };
@@ -0,0 +1,85 @@
+#include "time_manager.h"
+#include "configuration.h"
+#include <algorithm>
+
+namespace minizero::console {
+
+void TimeManager::reset()
+{
+    has_time_control_ = false;
+    main_time_ = byo_yomi_time_ = 0.0f;
+    byo_yomi_stones_ = 0;
+    resetClocks();
+}
+
+void TimeManager::resetClocks()
+{
+    for (Clock& clock : clocks_) {
+        clock.time_left_ = (main_time_ > 0 ? main_time_ : byo_yomi_time_);
+        clock.stones_left_ = (main_time_ > 0 ? 0 : byo_yomi_stones_);
+    }
+}
+
+void TimeManager::setTimeSettings(float main_time, float byo_yomi_time, int byo_yomi_stones)
+{
+    main_time_ = std::max(0.0f, main_time);
+    byo_yomi_time_ = std::max(0.0f, byo_yomi_time);
+    byo_yomi_stones_ = std::max(0, byo_yomi_stones);
+    // GTP: byo-yomi time without byo-yomi stones, or no time at all (time_settings 0 0 0), represents no time limit
+    has_time_control_ = !(byo_yomi_stones_ == 0 && (byo_yomi_time_ > 0 || main_time_ == 0));
+    resetClocks();
+}
+
+void TimeManager::setTimeLeft(env::Player player, float time_left, int stones_left)
+{
+    Clock& clock = getClock(player);
+    clock.time_left_ = std::max(0.0f, time_left);
+    clock.stones_left_ = std::max(0, stones_left);
+}
+
+void TimeManager::consumeTime(env::Player player, float spent_time)
+{
+    if (!has_time_control_) { return; }
+    Clock& clock = getClock(player);
+    if (clock.stones_left_ == 0) {
+        clock.time_left_ -= spent_time;
+        if (clock.time_left_ > 0 || byo_yomi_stones_ == 0) {
+            clock.time_left_ = std::max(0.0f, clock.time_left_);
+            return;
+        }
+        // the main time runs out during the move, and the rest is spent in the first byo-yomi period
+        spent_time = -clock.time_left_;
+        clock.time_left_ = byo_yomi_time_;
+        clock.stones_left_ = byo_yomi_stones_;
+    }
+    clock.time_left_ = std::max(0.0f, clock.time_left_ - spent_time);
+    if (--clock.stones_left_ == 0) { // a new byo-yomi period
+        clock.time_left_ = byo_yomi_time_;
+        clock.stones_left_ = byo_yomi_stones_;
+    }
+}
+
+std::pair<float, float> TimeManager::getTimeLimit(env::Player player) const
+{
+    if (!has_time_control_) { return {0.0f, 0.0f}; }
+
+    // the main time is shared by the expected moves to go, with the byo-yomi time of a stone on top of it;
+    // a byo-yomi period is shared by its stones, and an extension may borrow from the later stones of the period
+    const Clock& clock = getClock(player);
+    float time_limit = 0.0f;
+    float available_time = clock.time_left_;
+    if (clock.stones_left_ > 0) {
+        time_limit = clock.time_left_ / clock.stones_left_;
+    } else {
+        const float byo_yomi_time = (byo_yomi_stones_ > 0 ? byo_yomi_time_ / byo_yomi_stones_ : 0.0f);
+        time_limit = clock.time_left_ / std::max(1, config::actor_mcts_think_moves_to_go) + byo_yomi_time;
+        available_time += byo_yomi_time;
+    }
+    const float max_time_limit = std::min(time_limit * (1 + config::actor_mcts_think_time_extension), available_time);
+
+    // the margin covers the lag between the controller and the search, a zero time limit would disable it
+    const float kMinTimeLimit = 0.01f;
+    return {std::max(kMinTimeLimit, time_limit - config::actor_mcts_think_time_margin), std::max(kMinTimeLimit, max_time_limit - config::actor_mcts_think_time_margin)};
+}
+
+} // namespace minizero::console
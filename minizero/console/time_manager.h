@@ -0,0 +1,41 @@
+#pragma once
+
+#include "environment.h"
+#include <utility>
+
+namespace minizero::console {
+
+// the game clocks of GTP time_settings/time_left, which split the remaining time of a player into per-move time limits
+// the clock of a player is counted down by the time spent on its moves, and overwritten by time_left when the controller sends it
+class TimeManager {
+public:
+    TimeManager() { reset(); }
+
+    void reset();
+    void resetClocks();
+    void setTimeSettings(float main_time, float byo_yomi_time, int byo_yomi_stones);
+    void setTimeLeft(env::Player player, float time_left, int stones_left);
+    void consumeTime(env::Player player, float spent_time);
+
+    // the time limit of the next move of the player and its maximum extension, in seconds
+    std::pair<float, float> getTimeLimit(env::Player player) const;
+    inline bool hasTimeControl() const { return has_time_control_; }
+
+private:
+    class Clock {
+    public:
+        float time_left_; // the main time, or the time of the current byo-yomi period if stones_left_ > 0
+        int stones_left_; // the stones to play in the current byo-yomi period, 0 in the main time
+    };
+
+    inline Clock& getClock(env::Player player) { return clocks_[static_cast<int>(player)]; }
+    inline const Clock& getClock(env::Player player) const { return clocks_[static_cast<int>(player)]; }
+
+    bool has_time_control_;
+    float main_time_;
+    float byo_yomi_time_;
+    int byo_yomi_stones_;
+    Clock clocks_[static_cast<int>(env::Player::kPlayerSize)];
+};
+
+} // namespace minizero::console
@@ -215,7 +215,7 @@ void AtariEnvLoader::addObservations(const std::string& compressed_obs)
 std::vector<float> AtariEnvLoader::getFeaturesByReplay(const int pos, utils::Rotation rotation /* = utils::Rotation::kRotationNone */) const
 {
     AtariEnv env;
-    env.reset(std::stoi(getTag("SD")));
+    resetEnvironment(env);
     for (int i = 0; i < pos; ++i) { env.act(action_pairs_[i].first); }
     return env.getFeatures(rotation);
 }
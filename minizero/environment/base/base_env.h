@@ -7,6 +7,7 @@
 #include "vector_map.h"
 #include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <fstream>
 #include <memory>
 #include <sstream>
@@ -31,6 +32,9 @@ Player charToPlayer(char c);
 Player getNextPlayer(Player player, int num_player);
 Player getPreviousPlayer(Player player, int num_player);
 
+// Zobrist key of a stone of the player at the position
+inline uint64_t getZobristKey(int position, Player p) { return utils::mixHashKey((static_cast<uint64_t>(position) << 2) | static_cast<uint64_t>(p)); }
+
 class BaseAction {
 public:
     BaseAction() : action_id_(-1), player_(Player::kPlayerNone) {}
@@ -101,6 +105,16 @@ public:
     virtual int getNumPlayer() const = 0;
     virtual void setTurn(Player p) { turn_ = p; }
 
+    // hash key of the board position (the turn and the move number are not required to be included), used to detect transpositions
+    virtual bool supportHashKey() const { return false; }
+    virtual uint64_t getHashKey() const { return 0; }
+
+    // undoable acts, used to walk search paths on one environment instead of copying it
+    // only the acts after the latest checkpoint() are recorded, and can be undone in reverse order
+    virtual bool supportUndo() const { return false; }
+    virtual void checkpoint() {}
+    virtual void undo() { assert(false); }
+
     inline Player getTurn() const { return turn_; }
     inline const std::vector<Action>& getActionHistory() const { return actions_; }
     inline const std::vector<std::string>& getObservationHistory() const { return observations_; }
@@ -230,6 +244,9 @@ public:
         return oss.str();
     }
 
+    // the environment at the start of the record, on which the actions of the record can be replayed
+    virtual void resetEnvironment(Env& env) const { env.reset(); }
+
     virtual std::vector<float> getFeatures(const int pos, utils::Rotation rotation = utils::Rotation::kRotationNone) const
     {
         // a slow but naive method which simply replays the game again to get features
@@ -282,6 +299,7 @@ public:
         return true;
     }
     virtual float getPriority(const int pos) const { return 1.0f; }
+    virtual bool isPolicyTarget(const int pos) const { return (pos >= static_cast<int>(action_pairs_.size()) || action_pairs_[pos].second["F"].empty()); } // "F" marks a fast search of playout cap randomization
 
     virtual std::vector<float> getActionFeatures(const int pos, utils::Rotation rotation = utils::Rotation::kRotationNone) const = 0;
     virtual std::string name() const = 0;
@@ -89,6 +89,11 @@ GoEnv& GoEnv::operator=(const GoEnv& env)
     stone_bitboard_history_ = env.stone_bitboard_history_;
     hashkey_history_ = env.hashkey_history_;
     hash_table_ = env.hash_table_;
+    record_undo_ = false;
+    undo_records_.clear();
+    undo_grids_.clear();
+    undo_blocks_.clear();
+    undo_areas_.clear();
 
     // reset grid's block and area pointer
     for (auto& grid : grids_) {
@@ -127,6 +132,11 @@ void GoEnv::reset()
     stone_bitboard_history_.clear();
     hashkey_history_.clear();
     hash_table_.clear();
+    record_undo_ = false;
+    undo_records_.clear();
+    undo_grids_.clear();
+    undo_blocks_.clear();
+    undo_areas_.clear();
 }
 
 bool GoEnv::act(const GoAction& action)
@@ -136,6 +146,14 @@ bool GoEnv::act(const GoAction& action)
     const int position = action.getActionID();
     const Player player = action.getPlayer();
 
+    if (record_undo_) {
+        undo_records_.push_back(GoUndoRecord{turn_, hash_key_, false, free_area_id_bitboard_, free_block_id_bitboard_, stone_bitboard_, benson_bitboard_,
+                                             static_cast<int>(undo_grids_.size()), static_cast<int>(undo_blocks_.size()), static_cast<int>(undo_areas_.size())});
+        recorded_grid_bitboard_.reset();
+        recorded_block_id_bitboard_.reset();
+        recorded_area_id_bitboard_.reset();
+    }
+
     // handle global status
     turn_ = action.nextPlayer();
     hash_key_ ^= getGoTurnHashKey();
@@ -144,11 +162,13 @@ bool GoEnv::act(const GoAction& action)
     if (isPassAction(action)) {
         stone_bitboard_history_.push_back(stone_bitboard_);
         hashkey_history_.push_back(hash_key_);
-        hash_table_.insert(hash_key_);
+        bool is_new_hash_key = hash_table_.insert(hash_key_).second;
+        if (record_undo_) { undo_records_.back().is_new_hash_key_ = is_new_hash_key; }
         return true;
     }
 
     // set grid color
+    recordGrid(position);
     GoGrid& grid = grids_[position];
     grid.setPlayer(player);
     hash_key_ ^= getGoGridHashKey(position, player);
@@ -167,6 +187,7 @@ bool GoEnv::act(const GoAction& action)
             new_block->addLiberty(neighbor_pos);
         } else {
             GoBlock* neighbor_block = neighbor_grid.getBlock();
+            recordBlock(neighbor_block->getID());
             neighbor_block->removeLiberty(position);
             if (neighbor_block->getPlayer() == player) {
                 new_block = combineBlocks(new_block, neighbor_block);
@@ -179,7 +200,8 @@ bool GoEnv::act(const GoAction& action)
     stone_bitboard_.get(player) |= new_block->getGridBitboard();
     stone_bitboard_history_.push_back(stone_bitboard_);
     hashkey_history_.push_back(hash_key_);
-    hash_table_.insert(hash_key_);
+    bool is_new_hash_key = hash_table_.insert(hash_key_).second;
+    if (record_undo_) { undo_records_.back().is_new_hash_key_ = is_new_hash_key; }
 
     // update area & benson
     updateArea(action);
@@ -194,6 +216,53 @@ bool GoEnv::act(const std::vector<std::string>& action_string_args)
     return act(GoAction(action_string_args, board_size_));
 }
 
+void GoEnv::checkpoint()
+{
+    record_undo_ = true;
+    undo_records_.clear();
+    undo_grids_.clear();
+    undo_blocks_.clear();
+    undo_areas_.clear();
+}
+
+void GoEnv::undo()
+{
+    assert(!undo_records_.empty() && !actions_.empty());
+    const GoUndoRecord& record = undo_records_.back();
+    while (static_cast<int>(undo_grids_.size()) > record.num_undo_grids_) {
+        const GoUndoGrid& undo_grid = undo_grids_.back();
+        GoGrid& grid = grids_[undo_grid.position_];
+        grid.setPlayer(undo_grid.player_);
+        grid.setBlock(undo_grid.block_id_ == -1 ? nullptr : &blocks_[undo_grid.block_id_]);
+        for (Player player : {Player::kPlayer1, Player::kPlayer2}) {
+            int area_id = undo_grid.area_id_.get(player);
+            grid.setArea(player, area_id == -1 ? nullptr : &areas_[area_id]);
+        }
+        undo_grids_.pop_back();
+    }
+    while (static_cast<int>(undo_blocks_.size()) > record.num_undo_blocks_) {
+        blocks_[undo_blocks_.back().getID()] = undo_blocks_.back();
+        undo_blocks_.pop_back();
+    }
+    while (static_cast<int>(undo_areas_.size()) > record.num_undo_areas_) {
+        areas_[undo_areas_.back().getID()] = undo_areas_.back();
+        undo_areas_.pop_back();
+    }
+
+    if (record.is_new_hash_key_) { hash_table_.erase(hashkey_history_.back()); }
+    turn_ = record.turn_;
+    hash_key_ = record.hash_key_;
+    free_area_id_bitboard_ = record.free_area_id_bitboard_;
+    free_block_id_bitboard_ = record.free_block_id_bitboard_;
+    stone_bitboard_ = record.stone_bitboard_;
+    benson_bitboard_ = record.benson_bitboard_;
+    actions_.pop_back();
+    stone_bitboard_history_.pop_back();
+    hashkey_history_.pop_back();
+    undo_records_.pop_back();
+    assert(checkDataStructure());
+}
+
 std::vector<GoAction> GoEnv::getLegalActions() const
 {
     std::vector<GoAction> actions;
@@ -375,12 +444,14 @@ GoBlock* GoEnv::newBlock()
     assert(!free_block_id_bitboard_.none());
     int id = free_block_id_bitboard_._Find_first();
     free_block_id_bitboard_.reset(id);
+    recordBlock(id);
     return &blocks_[id];
 }
 
 void GoEnv::removeBlock(GoBlock* block)
 {
     assert(block && !free_block_id_bitboard_.test(block->getID()));
+    recordBlock(block->getID());
     free_block_id_bitboard_.set(block->getID());
     block->reset();
 }
@@ -402,6 +473,7 @@ void GoEnv::removeBlockFromBoard(GoBlock* block)
         }
     }
     assert(area);
+    recordArea(area->getID());
     area->setNumGrid(area->getNumGrid() + block->getNumGrid());
     area->setAreaBitBoard(area->getAreaBitboard() | block->getGridBitboard());
     area->removeNeighborBlockIDBitboard(block->getID());
@@ -417,6 +489,7 @@ void GoEnv::removeBlockFromBoard(GoBlock* block)
         int pos = grid_bitboard._Find_first();
         grid_bitboard.reset(pos);
 
+        recordGrid(pos);
         GoGrid& grid = grids_[pos];
         grid.setPlayer(Player::kPlayerNone);
         grid.setBlock(nullptr);
@@ -424,6 +497,7 @@ void GoEnv::removeBlockFromBoard(GoBlock* block)
         for (const auto& neighbor_pos : grid.getNeighbors()) {
             GoGrid& neighbor_grid = grids_[neighbor_pos];
             if (neighbor_grid.getPlayer() != getNextPlayer(block->getPlayer(), kGoNumPlayer)) { continue; }
+            recordBlock(neighbor_grid.getBlock()->getID());
             neighbor_grid.getBlock()->addLiberty(pos);
         }
     }
@@ -438,12 +512,14 @@ GoBlock* GoEnv::combineBlocks(GoBlock* block1, GoBlock* block2)
 
     if (block1 == block2) { return block1; }
     if (block1->getNumGrid() < block2->getNumGrid()) { return combineBlocks(block2, block1); }
+    recordBlock(block1->getID());
 
     // link grid to new block
     GoBitboard grid_bitboard = block2->getGridBitboard();
     while (!grid_bitboard.none()) {
         int pos = grid_bitboard._Find_first();
         grid_bitboard.reset(pos);
+        recordGrid(pos);
         grids_[pos].setBlock(block1);
     }
 
@@ -452,6 +528,7 @@ GoBlock* GoEnv::combineBlocks(GoBlock* block1, GoBlock* block2)
     while (!new_area_id_bitboard.none()) {
         int id = new_area_id_bitboard._Find_first();
         new_area_id_bitboard.reset(id);
+        recordArea(id);
         areas_[id].removeNeighborBlockIDBitboard(block2->getID());
         areas_[id].addNeighborBlockIDBitboard(block1->getID());
     }
@@ -479,6 +556,9 @@ void GoEnv::updateArea(const GoAction& action)
         if (own_area->getNumGrid() == 1) {
             removeArea(own_area);
         } else {
+            recordGrid(grid.getPosition());
+            recordBlock(grid.getBlock()->getID());
+            recordArea(own_area->getID());
             grid.setArea(action.getPlayer(), nullptr);
             grid.getBlock()->addNeighborAreaIDBitboard(own_area->getID());
             own_area->setNumGrid(own_area->getNumGrid() - 1);
@@ -498,6 +578,7 @@ void GoEnv::addArea(Player player, const GoBitboard& area_bitboard)
     // get available area id
     int area_id = free_area_id_bitboard_._Find_first();
     free_area_id_bitboard_.reset(area_id);
+    recordArea(area_id);
 
     GoArea* area = &areas_[area_id];
     area->setNumGrid(area_bitboard.count());
@@ -509,6 +590,7 @@ void GoEnv::addArea(Player player, const GoBitboard& area_bitboard)
     while (!grid_bitboard.none()) {
         int pos = grid_bitboard._Find_first();
         grid_bitboard.reset(pos);
+        recordGrid(pos);
         grids_[pos].setArea(player, area);
     }
 
@@ -517,6 +599,7 @@ void GoEnv::addArea(Player player, const GoBitboard& area_bitboard)
     while (!neighbor_block_bitboard.none()) {
         int pos = neighbor_block_bitboard._Find_first();
         GoBlock* block = grids_[pos].getBlock();
+        recordBlock(block->getID());
         block->addNeighborAreaIDBitboard(area->getID());
         area->addNeighborBlockIDBitboard(block->getID());
         neighbor_block_bitboard &= ~block->getGridBitboard();
@@ -526,12 +609,14 @@ void GoEnv::addArea(Player player, const GoBitboard& area_bitboard)
 void GoEnv::removeArea(GoArea* area)
 {
     assert(area && !free_area_id_bitboard_.test(area->getID()));
+    recordArea(area->getID());
 
     // remove grids pointer
     GoBitboard area_bitboard = area->getAreaBitboard();
     while (!area_bitboard.none()) {
         int pos = area_bitboard._Find_first();
         area_bitboard.reset(pos);
+        recordGrid(pos);
         grids_[pos].setArea(area->getPlayer(), nullptr);
     }
 
@@ -540,6 +625,7 @@ void GoEnv::removeArea(GoArea* area)
     while (!neighbor_block_id.none()) {
         int block_id = neighbor_block_id._Find_first();
         neighbor_block_id.reset(block_id);
+        recordBlock(block_id);
         blocks_[block_id].removeNeighborAreaIDBitboard(area->getID());
     }
 
@@ -552,6 +638,7 @@ GoArea* GoEnv::mergeArea(GoArea* area1, GoArea* area2)
 {
     assert(area1 && area2);
     if (area1->getNumGrid() < area2->getNumGrid()) { return mergeArea(area2, area1); }
+    recordArea(area1->getID());
 
     GoBitboard area2_bitboard = area2->getAreaBitboard(); // save area2 bitboard before removing area2
     GoBitboard area2_nbr_block_id = area2->getNeighborBlockIDBitboard();
@@ -560,11 +647,13 @@ GoArea* GoEnv::mergeArea(GoArea* area1, GoArea* area2)
     while (!area2_bitboard.none()) { // link grid to area
         int pos = area2_bitboard._Find_first();
         area2_bitboard.reset(pos);
+        recordGrid(pos);
         grids_[pos].setArea(area1->getPlayer(), area1);
     }
     while (!area2_nbr_block_id.none()) { // link block to area
         int id = area2_nbr_block_id._Find_first();
         area2_nbr_block_id.reset(id);
+        recordBlock(id);
         blocks_[id].addNeighborAreaIDBitboard(area1->getID());
     }
     return area1;
@@ -722,6 +811,30 @@ GamePair<float> GoEnv::calculateTrompTaylorTerritory() const
     return territory;
 }
 
+void GoEnv::recordGrid(int position)
+{
+    if (!record_undo_ || recorded_grid_bitboard_.test(position)) { return; }
+    recorded_grid_bitboard_.set(position);
+    const GoGrid& grid = grids_[position];
+    GamePair<int> area_id(grid.getArea(Player::kPlayer1) ? grid.getArea(Player::kPlayer1)->getID() : -1,
+                          grid.getArea(Player::kPlayer2) ? grid.getArea(Player::kPlayer2)->getID() : -1);
+    undo_grids_.push_back(GoUndoGrid{position, grid.getPlayer(), (grid.getBlock() ? grid.getBlock()->getID() : -1), area_id});
+}
+
+void GoEnv::recordBlock(int id)
+{
+    if (!record_undo_ || recorded_block_id_bitboard_.test(id)) { return; }
+    recorded_block_id_bitboard_.set(id);
+    undo_blocks_.push_back(blocks_[id]);
+}
+
+void GoEnv::recordArea(int id)
+{
+    if (!record_undo_ || recorded_area_id_bitboard_.test(id)) { return; }
+    recorded_area_id_bitboard_.set(id);
+    undo_areas_.push_back(areas_[id]);
+}
+
 std::vector<float> GoEnvLoader::getActionFeatures(const int pos, utils::Rotation rotation /* = utils::Rotation::kRotationNone */) const
 {
     const GoAction& action = action_pairs_[pos].first;
@@ -27,6 +27,30 @@ GoHashKey getGoSequenceHashKey(int move, int position, Player p);
 
 typedef BaseBoardAction<kGoNumPlayer> GoAction;
 
+// the status of an act to be undone, grids, blocks, and areas changed by the act are recorded separately
+class GoUndoRecord {
+public:
+    Player turn_;
+    GoHashKey hash_key_;
+    bool is_new_hash_key_; // whether the act inserted its hash key into the hash table
+    GoBitboard free_area_id_bitboard_;
+    GoBitboard free_block_id_bitboard_;
+    GamePair<GoBitboard> stone_bitboard_;
+    GamePair<GoBitboard> benson_bitboard_;
+    int num_undo_grids_;
+    int num_undo_blocks_;
+    int num_undo_areas_;
+};
+
+// a grid without its neighbors, blocks and areas are stored by id (-1 for none)
+class GoUndoGrid {
+public:
+    int position_;
+    Player player_;
+    int block_id_;
+    GamePair<int> area_id_;
+};
+
 class GoEnv : public BaseBoardEnv<GoAction> {
 public:
     friend class GoBenson;
@@ -58,7 +82,11 @@ public:
     inline std::string name() const override { return kGoName + "_" + std::to_string(getBoardSize()) + "x" + std::to_string(getBoardSize()); }
     inline int getNumPlayer() const override { return kGoNumPlayer; }
     inline float getKomi() const { return komi_; }
-    inline GoHashKey getHashKey() const { return hash_key_; }
+    inline bool supportHashKey() const override { return true; }
+    inline GoHashKey getHashKey() const override { return hash_key_; }
+    inline bool supportUndo() const override { return true; }
+    void checkpoint() override;
+    void undo() override;
     inline const GoBitboard& getBoardMaskBitboard() const { return board_mask_bitboard_; }
     inline const GoBitboard& getFreeAreaIDBitBoard() const { return free_area_id_bitboard_; }
     inline const GoBitboard& getFreeBlockIDBitBoard() const { return free_block_id_bitboard_; }
@@ -90,6 +118,9 @@ protected:
     std::string getCoordinateString() const;
     GoBitboard floodFillBitBoard(int start_position, const GoBitboard& boundary_bitboard) const;
     GamePair<float> calculateTrompTaylorTerritory() const;
+    void recordGrid(int position);
+    void recordBlock(int id);
+    void recordArea(int id);
 
     // check data structure (for debugging)
     bool checkDataStructure() const;
@@ -114,6 +145,16 @@ protected:
     std::vector<GamePair<GoBitboard>> stone_bitboard_history_;
     std::vector<GoHashKey> hashkey_history_;
     std::unordered_set<GoHashKey> hash_table_;
+
+    // undo journal, each grid, block, and area is recorded at most once per act before it changes
+    bool record_undo_;
+    GoBitboard recorded_grid_bitboard_;
+    GoBitboard recorded_block_id_bitboard_;
+    GoBitboard recorded_area_id_bitboard_;
+    std::vector<GoUndoRecord> undo_records_;
+    std::vector<GoUndoGrid> undo_grids_;
+    std::vector<GoBlock> undo_blocks_;
+    std::vector<GoArea> undo_areas_;
 };
 
 class GoEnvLoader : public BaseBoardEnvLoader<GoAction, GoEnv> {
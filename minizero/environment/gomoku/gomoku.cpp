@@ -15,7 +15,10 @@ void GomokuEnv::reset()
 {
     winner_ = Player::kPlayerNone;
     turn_ = Player::kPlayer1;
+    hash_key_ = 0;
     actions_.clear();
+    record_undo_ = false;
+    undo_records_.clear();
     board_.resize(board_size_ * board_size_);
     fill(board_.begin(), board_.end(), Player::kPlayerNone);
 }
@@ -23,8 +26,10 @@ void GomokuEnv::reset()
 bool GomokuEnv::act(const GomokuAction& action)
 {
     if (!isLegalAction(action)) { return false; }
+    if (record_undo_) { undo_records_.push_back(GomokuUndoRecord{turn_, winner_}); }
     actions_.push_back(action);
     board_[action.getActionID()] = action.getPlayer();
+    hash_key_ ^= getZobristKey(action.getActionID(), action.getPlayer());
     turn_ = action.nextPlayer();
     winner_ = updateWinner(action);
     return true;
@@ -35,6 +40,24 @@ bool GomokuEnv::act(const std::vector<std::string>& action_string_args)
     return act(GomokuAction(action_string_args));
 }
 
+void GomokuEnv::checkpoint()
+{
+    record_undo_ = true;
+    undo_records_.clear();
+}
+
+void GomokuEnv::undo()
+{
+    assert(!undo_records_.empty() && !actions_.empty());
+    const GomokuAction action = actions_.back();
+    actions_.pop_back();
+    board_[action.getActionID()] = Player::kPlayerNone;
+    hash_key_ ^= getZobristKey(action.getActionID(), action.getPlayer());
+    turn_ = undo_records_.back().turn_;
+    winner_ = undo_records_.back().winner_;
+    undo_records_.pop_back();
+}
+
 std::vector<GomokuAction> GomokuEnv::getLegalActions() const
 {
     std::vector<GomokuAction> actions;
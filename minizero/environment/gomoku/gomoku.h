@@ -14,6 +14,12 @@ const int kMaxGomokuBoardSize = 19;
 
 typedef BaseBoardAction<kGomokuNumPlayer> GomokuAction;
 
+class GomokuUndoRecord {
+public:
+    Player turn_;
+    Player winner_;
+};
+
 class GomokuEnv : public BaseBoardEnv<GomokuAction> {
 public:
     GomokuEnv()
@@ -37,6 +43,11 @@ public:
     std::string toString() const override;
     inline std::string name() const override { return kGomokuName + (config::env_gomoku_rule == "outer_open" ? "_oo_" : "_") + std::to_string(getBoardSize()) + "x" + std::to_string(getBoardSize()); }
     inline int getNumPlayer() const override { return kGomokuNumPlayer; }
+    inline bool supportHashKey() const override { return true; }
+    inline uint64_t getHashKey() const override { return hash_key_; }
+    inline bool supportUndo() const override { return true; }
+    void checkpoint() override;
+    void undo() override;
 
     inline int getRotatePosition(int position, utils::Rotation rotation) const override { return utils::getPositionByRotating(rotation, position, getBoardSize()); };
     inline int getRotateAction(int action_id, utils::Rotation rotation) const override { return getRotatePosition(action_id, rotation); };
@@ -47,7 +58,10 @@ private:
     std::string getCoordinateString() const;
 
     Player winner_;
+    uint64_t hash_key_;
     std::vector<Player> board_;
+    bool record_undo_;
+    std::vector<GomokuUndoRecord> undo_records_;
 };
 
 class GomokuEnvLoader : public BaseBoardEnvLoader<GomokuAction, GomokuEnv> {
@@ -14,7 +14,11 @@ void HexEnv::reset()
 {
     winner_ = Player::kPlayerNone;
     turn_ = Player::kPlayer1;
+    hash_key_ = 0;
     actions_.clear();
+    record_undo_ = false;
+    undo_records_.clear();
+    undo_cells_.clear();
     board_.resize(board_size_ * board_size_);
     fill(board_.begin(), board_.end(), Cell{Player::kPlayerNone, (Flag)0});
 }
@@ -22,6 +26,7 @@ void HexEnv::reset()
 bool HexEnv::act(const HexAction& action)
 {
     if (!isLegalAction(action)) { return false; }
+    if (record_undo_) { undo_records_.push_back(HexUndoRecord{turn_, winner_, hash_key_, static_cast<int>(undo_cells_.size())}); }
     actions_.push_back(action);
 
     int action_id = action.getActionID();
@@ -40,6 +45,8 @@ bool HexEnv::act(const HexAction& action)
             int reflected_id = reflected_row * board_size_ + reflected_col;
 
             // Clear original move
+            recordCell(actions_[0].getActionID());
+            hash_key_ ^= getZobristKey(actions_[0].getActionID(), board_[actions_[0].getActionID()].player);
             board_[actions_[0].getActionID()].player = Player::kPlayerNone;
             board_[actions_[0].getActionID()].flags = Flag::NONE;
 
@@ -47,8 +54,10 @@ bool HexEnv::act(const HexAction& action)
         }
     }
 
+    recordCell(action_id);
     Cell* cc{&board_[action_id]};
     cc->player = action.getPlayer();
+    hash_key_ ^= getZobristKey(action_id, cc->player);
     if (cc->player == Player::kPlayer1) {
         if (action_id % board_size_ == 0)
             cc->flags = Flag::EDGE1_CONNECTION;
@@ -72,6 +81,28 @@ bool HexEnv::act(const std::vector<std::string>& action_string_args)
     return act(HexAction(action_string_args));
 }
 
+void HexEnv::checkpoint()
+{
+    record_undo_ = true;
+    undo_records_.clear();
+    undo_cells_.clear();
+}
+
+void HexEnv::undo()
+{
+    assert(!undo_records_.empty() && !actions_.empty());
+    const HexUndoRecord& record = undo_records_.back();
+    while (static_cast<int>(undo_cells_.size()) > record.num_undo_cells_) {
+        board_[undo_cells_.back().first] = undo_cells_.back().second;
+        undo_cells_.pop_back();
+    }
+    turn_ = record.turn_;
+    winner_ = record.winner_;
+    hash_key_ = record.hash_key_;
+    actions_.pop_back();
+    undo_records_.pop_back();
+}
+
 std::vector<HexAction> HexEnv::getLegalActions() const
 {
     std::vector<HexAction> actions;
@@ -336,6 +367,7 @@ Player HexEnv::updateWinner(int action_id)
     }
 
     // Update from surrounding cells.
+    recordCell(action_id);
     Cell* my_cell = &board_[action_id];
     for (size_t ii = 0; ii < neighboor_cells_actions.size(); ii++) {
         Cell* neighboor{&board_[neighboor_cells_actions[ii]]};
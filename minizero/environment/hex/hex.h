@@ -3,6 +3,7 @@
 #include "base_env.h"
 #include "configuration.h"
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace minizero::env::hex {
@@ -31,6 +32,14 @@ struct Cell {
     Flag flags;
 };
 
+class HexUndoRecord {
+public:
+    Player turn_;
+    Player winner_;
+    uint64_t hash_key_;
+    int num_undo_cells_; // the size of undo_cells_ before the act
+};
+
 class HexEnv : public BaseBoardEnv<HexAction> {
 public:
     HexEnv()
@@ -55,6 +64,11 @@ public:
     std::string toStringDebug() const;
     inline std::string name() const override { return kHexName + "_" + std::to_string(getBoardSize()) + "x" + std::to_string(getBoardSize()); }
     inline int getNumPlayer() const override { return kHexNumPlayer; }
+    inline bool supportHashKey() const override { return true; }
+    inline uint64_t getHashKey() const override { return hash_key_; }
+    inline bool supportUndo() const override { return true; }
+    void checkpoint() override;
+    void undo() override;
     inline Player getWinner() const { return winner_; }
     inline const std::vector<Cell>& getBoard() const { return board_; }
     std::vector<int> getWinningStonesPosition() const;
@@ -63,9 +77,17 @@ public:
 
 private:
     Player updateWinner(int actionID);
+    inline void recordCell(int action_id)
+    {
+        if (record_undo_) { undo_cells_.emplace_back(action_id, board_[action_id]); }
+    }
 
     Player winner_;
+    uint64_t hash_key_;
     std::vector<Cell> board_;
+    bool record_undo_;
+    std::vector<HexUndoRecord> undo_records_;
+    std::vector<std::pair<int, Cell>> undo_cells_; // cells before being changed, restored in reverse order
 };
 
 class HexEnvLoader : public BaseBoardEnvLoader<HexAction, HexEnv> {
@@ -14,6 +14,8 @@ void OthelloEnv::reset()
 {
     turn_ = Player::kPlayer1;
     actions_.clear();
+    record_undo_ = false;
+    undo_records_.clear();
     legal_pass_.set(false, false);
     board_.reset();
     legal_board_.reset();
@@ -107,6 +109,7 @@ bool OthelloEnv::act(const OthelloAction& action)
     OthelloBitboard flip;       // pieces ready to flip
 
     if (!isLegalAction(action)) { return false; }
+    if (record_undo_) { undo_records_.push_back(OthelloUndoRecord{turn_, legal_pass_, legal_board_, board_}); }
     actions_.push_back(action);
     turn_ = action.nextPlayer();
     if (isPassAction(action)) { return true; }
@@ -144,6 +147,24 @@ bool OthelloEnv::act(const std::vector<std::string>& action_string_args)
     return act(OthelloAction(action_string_args, board_size_));
 }
 
+void OthelloEnv::checkpoint()
+{
+    record_undo_ = true;
+    undo_records_.clear();
+}
+
+void OthelloEnv::undo()
+{
+    assert(!undo_records_.empty() && !actions_.empty());
+    const OthelloUndoRecord& record = undo_records_.back();
+    turn_ = record.turn_;
+    legal_pass_ = record.legal_pass_;
+    legal_board_ = record.legal_board_;
+    board_ = record.board_;
+    actions_.pop_back();
+    undo_records_.pop_back();
+}
+
 std::string OthelloEnv::toString() const
 {
     std::ostringstream oss;
@@ -208,6 +229,12 @@ bool OthelloEnv::isTerminal() const
     return false;
 }
 
+uint64_t OthelloEnv::getHashKey() const
+{
+    // computed on demand, as a move may flip many stones
+    return utils::mixHashKey(std::hash<OthelloBitboard>()(board_.get(Player::kPlayer1))) ^ std::hash<OthelloBitboard>()(board_.get(Player::kPlayer2));
+}
+
 float OthelloEnv::getEvalScore(bool is_resign /*= false*/) const
 {
     Player result = (is_resign ? getNextPlayer(turn_, kOthelloNumPlayer) : eval());
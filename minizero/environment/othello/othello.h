@@ -17,6 +17,14 @@ typedef std::bitset<kMaxOthelloBoardSize * kMaxOthelloBoardSize> OthelloBitboard
 
 typedef BaseBoardAction<kOthelloNumPlayer> OthelloAction;
 
+class OthelloUndoRecord {
+public:
+    Player turn_;
+    GamePair<bool> legal_pass_;
+    GamePair<OthelloBitboard> legal_board_;
+    GamePair<OthelloBitboard> board_;
+};
+
 class OthelloEnv : public BaseBoardEnv<OthelloAction> {
 public:
     OthelloEnv()
@@ -40,6 +48,11 @@ public:
     std::string toString() const override;
     inline std::string name() const override { return kOthelloName + "_" + std::to_string(getBoardSize()) + "x" + std::to_string(getBoardSize()); }
     inline int getNumPlayer() const override { return kOthelloNumPlayer; }
+    inline bool supportHashKey() const override { return true; }
+    uint64_t getHashKey() const override;
+    inline bool supportUndo() const override { return true; }
+    void checkpoint() override;
+    void undo() override;
     inline bool isPassAction(const OthelloAction& action) const { return (action.getActionID() == getBoardSize() * getBoardSize()); }
 
     inline int getRotatePosition(int position, utils::Rotation rotation) const override { return utils::getPositionByRotating(rotation, position, getBoardSize()); };
@@ -68,6 +81,8 @@ private:
     GamePair<bool> legal_pass_;             // store black/white legal pass
     GamePair<OthelloBitboard> legal_board_; // store black/white legal board
     GamePair<OthelloBitboard> board_;       // store black/white board
+    bool record_undo_;
+    std::vector<OthelloUndoRecord> undo_records_;
 };
 
 class OthelloEnvLoader : public BaseBoardEnvLoader<OthelloAction, OthelloEnv> {
@@ -48,12 +48,13 @@ public:
     }
 
     inline int getSeed() const { return std::stoi(BaseEnvLoader<Action, Env>::getTag("SD")); }
+    void resetEnvironment(Env& env) const override { env.reset(getSeed()); }
 
     std::vector<float> getFeatures(const int pos, utils::Rotation rotation = utils::Rotation::kRotationNone) const override
     {
         // a slow but naive method which simply replays the game again to get features
         Env env;
-        env.reset(getSeed());
+        resetEnvironment(env);
         const auto& action_pairs_ = BaseEnvLoader<Action, Env>::action_pairs_;
         for (int i = 0; i < std::min(pos, static_cast<int>(action_pairs_.size())); ++i) { env.act(action_pairs_[i].first); }
         return env.getFeatures(rotation);
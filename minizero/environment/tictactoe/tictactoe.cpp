@@ -11,7 +11,10 @@ using namespace minizero::utils;
 void TicTacToeEnv::reset()
 {
     turn_ = Player::kPlayer1;
+    hash_key_ = 0;
     actions_.clear();
+    record_undo_ = false;
+    undo_turns_.clear();
     board_.resize(kTicTacToeBoardSize * kTicTacToeBoardSize);
     fill(board_.begin(), board_.end(), Player::kPlayerNone);
 }
@@ -19,8 +22,10 @@ void TicTacToeEnv::reset()
 bool TicTacToeEnv::act(const TicTacToeAction& action)
 {
     if (!isLegalAction(action)) { return false; }
+    if (record_undo_) { undo_turns_.push_back(turn_); }
     actions_.push_back(action);
     board_[action.getActionID()] = action.getPlayer();
+    hash_key_ ^= getZobristKey(action.getActionID(), action.getPlayer());
     turn_ = action.nextPlayer();
     return true;
 }
@@ -30,6 +35,23 @@ bool TicTacToeEnv::act(const std::vector<std::string>& action_string_args)
     return act(TicTacToeAction(action_string_args));
 }
 
+void TicTacToeEnv::checkpoint()
+{
+    record_undo_ = true;
+    undo_turns_.clear();
+}
+
+void TicTacToeEnv::undo()
+{
+    assert(!undo_turns_.empty() && !actions_.empty());
+    const TicTacToeAction action = actions_.back();
+    actions_.pop_back();
+    board_[action.getActionID()] = Player::kPlayerNone;
+    hash_key_ ^= getZobristKey(action.getActionID(), action.getPlayer());
+    turn_ = undo_turns_.back();
+    undo_turns_.pop_back();
+}
+
 std::vector<TicTacToeAction> TicTacToeEnv::getLegalActions() const
 {
     std::vector<TicTacToeAction> actions;
@@ -31,13 +31,21 @@ public:
     std::string toString() const override;
     inline std::string name() const override { return kTicTacToeName; }
     inline int getNumPlayer() const override { return kTicTacToeNumPlayer; }
+    inline bool supportHashKey() const override { return true; }
+    inline uint64_t getHashKey() const override { return hash_key_; }
+    inline bool supportUndo() const override { return true; }
+    void checkpoint() override;
+    void undo() override;
     inline int getRotatePosition(int position, utils::Rotation rotation) const override { return utils::getPositionByRotating(rotation, position, getBoardSize()); };
     inline int getRotateAction(int action_id, utils::Rotation rotation) const override { return getRotatePosition(action_id, rotation); };
 
 private:
     Player eval() const;
 
+    uint64_t hash_key_;
     std::vector<Player> board_;
+    bool record_undo_;
+    std::vector<Player> undo_turns_; // the turn before each act after the checkpoint
 };
 
 class TicTacToeEnvLoader : public BaseBoardEnvLoader<TicTacToeAction, TicTacToeEnv> {
@@ -26,15 +26,18 @@ void ReplayBuffer::addData(const EnvironmentLoader& env_loader)
     std::pair<int, int> data_range = env_loader.getDataRange();
     std::deque<float> position_priorities(data_range.second + 1, 0.0f);
     float game_priority = 0.0f;
+    int num_data = 0;
     for (int i = data_range.first; i <= data_range.second; ++i) {
+        if (!env_loader.isPolicyTarget(i)) { continue; } // never sample the positions of fast searches
         position_priorities[i] = std::pow((config::learner_use_per ? env_loader.getPriority(i) : 1.0f), config::learner_per_alpha);
         game_priority += position_priorities[i];
+        ++num_data;
     }
 
     std::lock_guard<std::mutex> lock(mutex_);
 
     // add new data to replay buffer
-    num_data_ += (data_range.second - data_range.first + 1);
+    num_data_ += num_data;
     position_priorities_.push_back(position_priorities);
     game_priorities_.push_back(game_priority);
     env_loaders_.push_back(env_loader);
@@ -43,7 +46,7 @@ void ReplayBuffer::addData(const EnvironmentLoader& env_loader)
     const size_t replay_buffer_max_size = config::zero_replay_buffer * config::zero_num_games_per_iteration;
     while (position_priorities_.size() > replay_buffer_max_size) {
         data_range = env_loaders_.front().getDataRange();
-        num_data_ -= (data_range.second - data_range.first + 1);
+        for (int i = data_range.first; i <= data_range.second; ++i) { num_data_ -= (env_loaders_.front().isPolicyTarget(i) ? 1 : 0); }
         position_priorities_.pop_front();
         game_priorities_.pop_front();
         env_loaders_.pop_front();
@@ -1,5 +1,6 @@
 #!/usr/bin/env python
 
+import os
 import sys
 import time
 import torch
@@ -43,6 +44,9 @@ class MinizeroDadaLoader:
             if file_name in self.data_list:
                 continue
             self.data_loader.load_data_from_file(file_name)
+            # the games reanalysed in the iteration, if any
+            if os.path.isfile(f"{training_dir}/sgf/{i}_re.sgf"):
+                self.data_loader.load_data_from_file(f"{training_dir}/sgf/{i}_re.sgf")
             self.data_list.append(file_name)
             if len(self.data_list) > py.get_zero_replay_buffer():
                 self.data_list.pop(0)
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "network.h"
+#include "time_profiler.h"
 #include "utils.h"
 #include <algorithm>
 #include <memory>
@@ -60,14 +61,19 @@ public:
         return index;
     }
 
-    std::vector<std::shared_ptr<NetworkOutput>> forward()
+    virtual std::vector<std::shared_ptr<NetworkOutput>> forward()
     {
         assert(batch_size_ > 0);
-        auto forward_result = network_.forward(std::vector<torch::jit::IValue>{torch::cat(tensor_input_).to(getDevice())}).toGenericDict();
+        torch::Tensor policy_output, policy_logits_output, value_output;
+        {
+            utils::ScopedStageTimer timer(utils::TimeProfiler::Stage::kForward);
+            auto forward_result = network_.forward(std::vector<torch::jit::IValue>{torch::cat(tensor_input_).to(getDevice())}).toGenericDict();
+            policy_output = forward_result.at("policy").toTensor().to(at::kCPU);
+            policy_logits_output = forward_result.at("policy_logit").toTensor().to(at::kCPU);
+            value_output = forward_result.at("value").toTensor().to(at::kCPU);
+        }
 
-        auto policy_output = forward_result.at("policy").toTensor().to(at::kCPU);
-        auto policy_logits_output = forward_result.at("policy_logit").toTensor().to(at::kCPU);
-        auto value_output = forward_result.at("value").toTensor().to(at::kCPU);
+        utils::ScopedStageTimer timer(utils::TimeProfiler::Stage::kOutputDecoding);
         assert(policy_output.numel() == batch_size_ * getActionSize());
         assert(policy_logits_output.numel() == batch_size_ * getActionSize());
         assert(value_output.numel() == batch_size_ * getDiscreteValueSize());
@@ -105,7 +111,7 @@ public:
 
     inline int getBatchSize() const { return batch_size_; }
 
-private:
+protected:
     inline void clear()
     {
         batch_size_ = 0;
@@ -120,4 +126,41 @@ private:
     const int kReserved_batch_size = 4096;
 };
 
+// an alphazero network without a model, whose outputs are a uniform policy and a zero value, for measuring everything but the model
+class SyntheticAlphaZeroNetwork : public AlphaZeroNetwork {
+public:
+    SyntheticAlphaZeroNetwork(const std::string& game_name, int num_input_channels, int input_channel_height, int input_channel_width, int action_size)
+    {
+        gpu_id_ = -1;
+        num_input_channels_ = num_input_channels;
+        input_channel_height_ = input_channel_height;
+        input_channel_width_ = input_channel_width;
+        num_hidden_channels_ = hidden_channel_height_ = hidden_channel_width_ = 0;
+        num_blocks_ = 0;
+        action_size_ = action_size;
+        num_value_hidden_channels_ = 0;
+        discrete_value_size_ = 1;
+        game_name_ = game_name;
+        network_type_name_ = "alphazero";
+        network_file_name_ = "synthetic";
+    }
+
+    void loadModel(const std::string& nn_file_name, const int gpu_id) override { clear(); }
+
+    std::vector<std::shared_ptr<NetworkOutput>> forward() override
+    {
+        assert(getBatchSize() > 0);
+        utils::ScopedStageTimer timer(utils::TimeProfiler::Stage::kOutputDecoding);
+        std::vector<std::shared_ptr<NetworkOutput>> network_outputs;
+        for (int i = 0; i < getBatchSize(); ++i) {
+            std::shared_ptr<AlphaZeroNetworkOutput> alphazero_network_output = std::make_shared<AlphaZeroNetworkOutput>(getActionSize());
+            std::fill(alphazero_network_output->policy_.begin(), alphazero_network_output->policy_.end(), 1.0f / getActionSize());
+            network_outputs.push_back(alphazero_network_output);
+        }
+
+        clear();
+        return network_outputs;
+    }
+};
+
 } // namespace minizero::network
@@ -0,0 +1,220 @@
+#include "inference_service.h"
+#include "alphazero_network.h"
+#include "muzero_network.h"
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <utility>
+
+namespace minizero::network {
+
+InferenceRequestQueue::InferenceRequestQueue()
+    : head_(&stub_),
+      tail_(&stub_)
+{
+    stub_.next_ = nullptr;
+}
+
+InferenceRequestQueue::~InferenceRequestQueue()
+{
+    while (InferenceRequest* request = pop()) { delete request; }
+}
+
+void InferenceRequestQueue::push(InferenceRequest* request)
+{
+    request->next_.store(nullptr, std::memory_order_relaxed);
+    InferenceRequest* prev = head_.exchange(request, std::memory_order_acq_rel);
+    prev->next_.store(request, std::memory_order_release);
+}
+
+InferenceRequest* InferenceRequestQueue::pop()
+{
+    InferenceRequest* tail = tail_;
+    InferenceRequest* next = tail->next_.load(std::memory_order_acquire);
+    if (tail == &stub_) {
+        if (!next) { return nullptr; }
+        tail_ = next;
+        tail = next;
+        next = next->next_.load(std::memory_order_acquire);
+    }
+    if (next) {
+        tail_ = next;
+        return tail;
+    }
+    if (tail != head_.load(std::memory_order_acquire)) { return nullptr; }
+
+    // the last request is only popped once the stub is behind it
+    push(&stub_);
+    next = tail->next_.load(std::memory_order_acquire);
+    if (next) {
+        tail_ = next;
+        return tail;
+    }
+    return nullptr;
+}
+
+InferenceService::InferenceService(std::shared_ptr<Network> network, int max_batch_size, int max_wait_microseconds)
+    : network_(network),
+      max_batch_size_(std::max(1, max_batch_size)),
+      max_wait_time_(std::max(0, max_wait_microseconds)),
+      num_submitted_requests_(0),
+      num_received_requests_(0),
+      num_batches_(0),
+      num_evaluations_(0),
+      is_waiting_(false),
+      is_stopped_(false)
+{
+    assert(network_);
+    thread_ = std::thread(&InferenceService::run, this);
+}
+
+InferenceService::~InferenceService()
+{
+    {
+        std::lock_guard<std::mutex> lock(wait_mutex_);
+        is_stopped_ = true;
+    }
+    wait_condition_.notify_one();
+    thread_.join();
+}
+
+void InferenceService::forward(std::vector<float> features, Callback callback)
+{
+    InferenceRequest* request = new InferenceRequest();
+    request->type_ = InferenceRequest::Type::kForward;
+    request->features_ = std::move(features);
+    request->callback_ = std::move(callback);
+    submit(request);
+}
+
+std::future<std::shared_ptr<NetworkOutput>> InferenceService::forward(std::vector<float> features)
+{
+    std::shared_ptr<std::promise<std::shared_ptr<NetworkOutput>>> promise = std::make_shared<std::promise<std::shared_ptr<NetworkOutput>>>();
+    forward(std::move(features), [promise](const std::shared_ptr<NetworkOutput>& network_output) { promise->set_value(network_output); });
+    return promise->get_future();
+}
+
+void InferenceService::recurrentInference(const void* hidden_state, torch::ScalarType hidden_state_type, std::vector<float> actions, Callback callback)
+{
+    // the hidden state is copied, so it may be released or overwritten once submitted
+    const size_t hidden_state_bytes = network_->getNumHiddenChannels() * network_->getHiddenChannelHeight() * network_->getHiddenChannelWidth() * c10::elementSize(hidden_state_type);
+    InferenceRequest* request = new InferenceRequest();
+    request->type_ = InferenceRequest::Type::kRecurrentInference;
+    request->features_ = std::move(actions);
+    request->hidden_state_.assign(static_cast<const char*>(hidden_state), static_cast<const char*>(hidden_state) + hidden_state_bytes);
+    request->hidden_state_type_ = hidden_state_type;
+    request->callback_ = std::move(callback);
+    submit(request);
+}
+
+std::future<std::shared_ptr<NetworkOutput>> InferenceService::recurrentInference(const void* hidden_state, torch::ScalarType hidden_state_type, std::vector<float> actions)
+{
+    std::shared_ptr<std::promise<std::shared_ptr<NetworkOutput>>> promise = std::make_shared<std::promise<std::shared_ptr<NetworkOutput>>>();
+    recurrentInference(hidden_state, hidden_state_type, std::move(actions), [promise](const std::shared_ptr<NetworkOutput>& network_output) { promise->set_value(network_output); });
+    return promise->get_future();
+}
+
+void InferenceService::loadModel(const std::string& nn_file_name)
+{
+    // the queued requests are evaluated by the new model
+    std::lock_guard<std::mutex> lock(network_mutex_);
+    network_->loadModel(nn_file_name, network_->getGPUID());
+}
+
+void InferenceService::submit(InferenceRequest* request)
+{
+    assert(!is_stopped_);
+    request->submit_time_ = std::chrono::steady_clock::now();
+    queue_.push(request);
+    ++num_submitted_requests_;
+
+    // the service thread checks the number of submitted requests after announcing its wait, so no wake-up is lost
+    if (is_waiting_) {
+        std::lock_guard<std::mutex> lock(wait_mutex_);
+        wait_condition_.notify_one();
+    }
+}
+
+void InferenceService::run()
+{
+    while (true) {
+        receiveRequests();
+
+        // a batch is evaluated once it is full, or once its first request reaches the maximum wait time
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+        bool is_evaluated = false;
+        for (auto& requests : pending_requests_) {
+            if (requests.empty()) { continue; }
+            const std::chrono::steady_clock::time_point request_deadline = requests.front()->submit_time_ + max_wait_time_;
+            if (static_cast<int>(requests.size()) >= max_batch_size_ || now >= request_deadline || is_stopped_) {
+                evaluateBatch(requests);
+                is_evaluated = true;
+            } else {
+                deadline = std::min(deadline, request_deadline);
+            }
+        }
+        if (is_evaluated) { continue; }
+        if (is_stopped_ && num_submitted_requests_ == num_received_requests_) { break; }
+        waitRequests(deadline);
+    }
+}
+
+void InferenceService::receiveRequests()
+{
+    while (InferenceRequest* request = queue_.pop()) {
+        ++num_received_requests_;
+        pending_requests_[static_cast<int>(request->type_)].emplace_back(request);
+    }
+}
+
+void InferenceService::waitRequests(std::chrono::steady_clock::time_point deadline)
+{
+    std::unique_lock<std::mutex> lock(wait_mutex_);
+    is_waiting_ = true;
+    auto isReady = [this]() { return is_stopped_ || num_submitted_requests_ != num_received_requests_; };
+    if (deadline == std::chrono::steady_clock::time_point::max()) {
+        wait_condition_.wait(lock, isReady);
+    } else {
+        wait_condition_.wait_until(lock, deadline, isReady);
+    }
+    is_waiting_ = false;
+}
+
+void InferenceService::evaluateBatch(std::vector<std::unique_ptr<InferenceRequest>>& requests)
+{
+    const int batch_size = std::min<int>(requests.size(), max_batch_size_);
+    std::vector<int> indices(batch_size);
+    std::vector<std::shared_ptr<NetworkOutput>> network_outputs;
+    // the actors wait for the outputs of the batch without a timeout, so an error of the network would leave them blocked forever
+    try {
+        std::lock_guard<std::mutex> lock(network_mutex_);
+        if (network_->getNetworkTypeName() == "alphazero") {
+            std::shared_ptr<AlphaZeroNetwork> alphazero_network = std::static_pointer_cast<AlphaZeroNetwork>(network_);
+            for (int i = 0; i < batch_size; ++i) { indices[i] = alphazero_network->pushBack(std::move(requests[i]->features_)); }
+            network_outputs = alphazero_network->forward();
+        } else if (network_->getNetworkTypeName() == "muzero" || network_->getNetworkTypeName() == "muzero_atari") {
+            std::shared_ptr<MuZeroNetwork> muzero_network = std::static_pointer_cast<MuZeroNetwork>(network_);
+            if (requests.front()->type_ == InferenceRequest::Type::kForward) {
+                for (int i = 0; i < batch_size; ++i) { indices[i] = muzero_network->pushBackInitialData(std::move(requests[i]->features_)); }
+                network_outputs = muzero_network->initialInference();
+            } else {
+                for (int i = 0; i < batch_size; ++i) { indices[i] = muzero_network->pushBackRecurrentData(requests[i]->hidden_state_.data(), requests[i]->hidden_state_type_, requests[i]->features_); }
+                network_outputs = muzero_network->recurrentInference();
+            }
+        } else {
+            assert(false); // should not be here
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "inference service failed to evaluate a batch of " << batch_size << " requests: " << e.what() << std::endl;
+        std::abort();
+    }
+
+    ++num_batches_;
+    num_evaluations_ += batch_size;
+    for (int i = 0; i < batch_size; ++i) { requests[i]->callback_(network_outputs[indices[i]]); }
+    requests.erase(requests.begin(), requests.begin() + batch_size);
+}
+
+} // namespace minizero::network
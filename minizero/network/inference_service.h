@@ -0,0 +1,95 @@
+#pragma once
+
+#include "cpu_affinity.h"
+#include "network.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace minizero::network {
+
+class InferenceRequest {
+public:
+    enum class Type {
+        kForward,           // alphazero forward, or muzero initial inference
+        kRecurrentInference // muzero recurrent inference
+    };
+
+    Type type_;
+    std::vector<float> features_;    // the features, or the actions of a recurrent inference
+    std::vector<char> hidden_state_; // the hidden state of a recurrent inference, stored as hidden_state_type_
+    torch::ScalarType hidden_state_type_;
+    std::function<void(const std::shared_ptr<NetworkOutput>&)> callback_;
+    std::chrono::steady_clock::time_point submit_time_;
+    std::atomic<InferenceRequest*> next_;
+};
+
+// a lock-free queue of many producers and a single consumer, where a push never waits for the other threads
+// reference: Vyukov, Intrusive MPSC node-based queue
+class InferenceRequestQueue {
+public:
+    InferenceRequestQueue();
+    ~InferenceRequestQueue();
+
+    void push(InferenceRequest* request);
+    InferenceRequest* pop(); // nullptr if empty, or if a push is not finished yet
+
+private:
+    std::atomic<InferenceRequest*> head_;
+    InferenceRequest* tail_;
+    InferenceRequest stub_;
+};
+
+// forms batches of the requests from any thread, up to a maximum batch size or until the first request waits too long,
+// and evaluates them on a dedicated thread; the network is only used by the service thread while the service owns it
+class InferenceService {
+public:
+    using Callback = std::function<void(const std::shared_ptr<NetworkOutput>&)>;
+
+    InferenceService(std::shared_ptr<Network> network, int max_batch_size, int max_wait_microseconds);
+    ~InferenceService();
+
+    void forward(std::vector<float> features, Callback callback);
+    std::future<std::shared_ptr<NetworkOutput>> forward(std::vector<float> features);
+    void recurrentInference(const void* hidden_state, torch::ScalarType hidden_state_type, std::vector<float> actions, Callback callback);
+    std::future<std::shared_ptr<NetworkOutput>> recurrentInference(const void* hidden_state, torch::ScalarType hidden_state_type, std::vector<float> actions);
+    void loadModel(const std::string& nn_file_name);
+    inline bool setThreadAffinity(const std::vector<int>& cpus) { return utils::setThreadAffinity(thread_.native_handle(), cpus); }
+
+    inline std::shared_ptr<Network> getNetwork() const { return network_; }
+    inline int getMaxBatchSize() const { return max_batch_size_; }
+    inline uint64_t getNumBatches() const { return num_batches_; }
+    inline uint64_t getNumEvaluations() const { return num_evaluations_; }
+
+private:
+    void submit(InferenceRequest* request);
+    void run();
+    void receiveRequests();
+    void waitRequests(std::chrono::steady_clock::time_point deadline);
+    void evaluateBatch(std::vector<std::unique_ptr<InferenceRequest>>& requests);
+
+    std::shared_ptr<Network> network_;
+    int max_batch_size_;
+    std::chrono::microseconds max_wait_time_;
+    InferenceRequestQueue queue_;
+    std::vector<std::unique_ptr<InferenceRequest>> pending_requests_[2]; // by request type, only accessed by the service thread
+    std::atomic<uint64_t> num_submitted_requests_;
+    uint64_t num_received_requests_;
+    std::atomic<uint64_t> num_batches_;
+    std::atomic<uint64_t> num_evaluations_;
+    std::atomic<bool> is_waiting_;
+    std::atomic<bool> is_stopped_;
+    std::mutex wait_mutex_;
+    std::condition_variable wait_condition_;
+    std::mutex network_mutex_; // held by the service thread while evaluating a batch
+    std::thread thread_;
+};
+
+} // namespace minizero::network
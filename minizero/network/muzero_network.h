@@ -1,10 +1,13 @@
 #pragma once
 
 #include "network.h"
+#include "time_profiler.h"
 #include "utils.h"
 #include <algorithm>
+#include <cstring>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -37,10 +40,6 @@ public:
         initial_input_batch_size_ = recurrent_input_batch_size_ = 0;
         initial_tensor_input_.clear();
         initial_tensor_input_.reserve(kReserved_batch_size);
-        recurrent_tensor_feature_input_.clear();
-        recurrent_tensor_feature_input_.reserve(kReserved_batch_size);
-        recurrent_tensor_action_input_.clear();
-        recurrent_tensor_action_input_.reserve(kReserved_batch_size);
     }
 
     void loadModel(const std::string& nn_file_name, const int gpu_id) override
@@ -51,6 +50,8 @@ public:
         num_action_feature_channels_ = network_.get_method("get_num_action_feature_channels")(dummy).toInt();
         initial_input_batch_size_ = 0;
         recurrent_input_batch_size_ = 0;
+        recurrent_feature_input_ = torch::Tensor();
+        recurrent_action_input_ = torch::empty({kReserved_batch_size, getNumActionFeatureChannels(), getHiddenChannelHeight(), getHiddenChannelWidth()}, torch::kFloat);
     }
 
     std::string toString() const override
@@ -75,20 +76,35 @@ public:
         return index;
     }
 
-    int pushBackRecurrentData(std::vector<float> features, std::vector<float> actions)
+    int pushBackRecurrentData(const std::vector<float>& features, const std::vector<float>& actions)
     {
         assert(static_cast<int>(features.size()) == getNumHiddenChannels() * getHiddenChannelHeight() * getHiddenChannelWidth());
+        return pushBackRecurrentData(features.data(), torch::kFloat, actions);
+    }
+
+    // the hidden state is copied as is into the batch, stored as the given type (float, half, or bfloat16), and converted to float on the device
+    int pushBackRecurrentData(const void* hidden_state, torch::ScalarType hidden_state_type, const std::vector<float>& actions)
+    {
         assert(static_cast<int>(actions.size()) == getNumActionFeatureChannels() * getHiddenChannelHeight() * getHiddenChannelWidth());
 
         int index;
         {
-            std::lock_guard<std::mutex> lock(recurrent_mutex_);
+            // the batch buffers are only replaced under the unique lock, so no other thread is copying into them
+            std::unique_lock<std::shared_mutex> lock(recurrent_mutex_);
+            if (recurrent_input_batch_size_ == 0 && (!recurrent_feature_input_.defined() || recurrent_feature_input_.scalar_type() != hidden_state_type)) {
+                recurrent_feature_input_ = torch::empty({recurrent_action_input_.size(0), getNumHiddenChannels(), getHiddenChannelHeight(), getHiddenChannelWidth()}, hidden_state_type);
+            }
+            assert(recurrent_feature_input_.scalar_type() == hidden_state_type);
+            if (recurrent_input_batch_size_ == recurrent_action_input_.size(0)) {
+                recurrent_feature_input_ = growBatch(recurrent_feature_input_, recurrent_input_batch_size_);
+                recurrent_action_input_ = growBatch(recurrent_action_input_, recurrent_input_batch_size_);
+            }
             index = recurrent_input_batch_size_++;
-            recurrent_tensor_feature_input_.resize(recurrent_input_batch_size_);
-            recurrent_tensor_action_input_.resize(recurrent_input_batch_size_);
         }
-        recurrent_tensor_feature_input_[index] = torch::from_blob(features.data(), {1, getNumHiddenChannels(), getHiddenChannelHeight(), getHiddenChannelWidth()}).clone();
-        recurrent_tensor_action_input_[index] = torch::from_blob(actions.data(), {1, getNumActionFeatureChannels(), getHiddenChannelHeight(), getHiddenChannelWidth()}).clone();
+        std::shared_lock<std::shared_mutex> lock(recurrent_mutex_);
+        const size_t hidden_state_bytes = recurrent_feature_input_.stride(0) * recurrent_feature_input_.element_size();
+        std::memcpy(static_cast<char*>(recurrent_feature_input_.data_ptr()) + index * hidden_state_bytes, hidden_state, hidden_state_bytes);
+        std::memcpy(recurrent_action_input_.data_ptr<float>() + index * actions.size(), actions.data(), actions.size() * sizeof(float));
         return index;
     }
 
@@ -106,12 +122,9 @@ public:
     {
         assert(recurrent_input_batch_size_ > 0);
         auto outputs = forward("recurrent_inference",
-                               {{torch::cat(recurrent_tensor_feature_input_).to(getDevice())}, {torch::cat(recurrent_tensor_action_input_).to(getDevice())}},
+                               {{recurrent_feature_input_.narrow(0, 0, recurrent_input_batch_size_).to(getDevice()).to(torch::kFloat)},
+                                {recurrent_action_input_.narrow(0, 0, recurrent_input_batch_size_).to(getDevice())}},
                                recurrent_input_batch_size_);
-        recurrent_tensor_feature_input_.clear();
-        recurrent_tensor_feature_input_.reserve(kReserved_batch_size);
-        recurrent_tensor_action_input_.clear();
-        recurrent_tensor_action_input_.reserve(kReserved_batch_size);
         recurrent_input_batch_size_ = 0;
         return outputs;
     }
@@ -121,20 +134,38 @@ public:
     inline int getRecurrentInputBatchSize() const { return recurrent_input_batch_size_; }
 
 private:
+    // a batch buffer of twice the size, with the first batch_size samples copied
+    static torch::Tensor growBatch(const torch::Tensor& batch, int batch_size)
+    {
+        std::vector<int64_t> sizes = batch.sizes().vec();
+        sizes[0] *= 2;
+        torch::Tensor grown_batch = torch::empty(sizes, batch.scalar_type());
+        grown_batch.narrow(0, 0, batch_size).copy_(batch.narrow(0, 0, batch_size));
+        return grown_batch;
+    }
+
     std::vector<std::shared_ptr<NetworkOutput>> forward(const std::string& method, const std::vector<torch::jit::IValue>& inputs, int batch_size)
     {
         assert(network_.find_method(method));
 
-        auto forward_result = network_.get_method(method)(inputs).toGenericDict();
-        auto policy_output = forward_result.at("policy").toTensor().to(at::kCPU);
-        auto policy_logits_output = forward_result.at("policy_logit").toTensor().to(at::kCPU);
-        auto value_output = forward_result.at("value").toTensor().to(at::kCPU);
-        auto reward_output = (forward_result.contains("reward") ? forward_result.at("reward").toTensor().to(at::kCPU) : torch::zeros(0));
-        auto hidden_state_output = forward_result.at("hidden_state").toTensor().to(at::kCPU);
+        bool has_reward;
+        torch::Tensor policy_output, policy_logits_output, value_output, reward_output, hidden_state_output;
+        {
+            utils::ScopedStageTimer timer(utils::TimeProfiler::Stage::kForward);
+            auto forward_result = network_.get_method(method)(inputs).toGenericDict();
+            policy_output = forward_result.at("policy").toTensor().to(at::kCPU);
+            policy_logits_output = forward_result.at("policy_logit").toTensor().to(at::kCPU);
+            value_output = forward_result.at("value").toTensor().to(at::kCPU);
+            reward_output = (forward_result.contains("reward") ? forward_result.at("reward").toTensor().to(at::kCPU) : torch::zeros(0));
+            hidden_state_output = forward_result.at("hidden_state").toTensor().to(at::kCPU);
+            has_reward = forward_result.contains("reward");
+        }
+
+        utils::ScopedStageTimer timer(utils::TimeProfiler::Stage::kOutputDecoding);
         assert(policy_output.numel() == batch_size * getActionSize());
         assert(policy_logits_output.numel() == batch_size * getActionSize());
         assert((getNetworkTypeName() != "muzero_atari" && value_output.numel() == batch_size) || (getNetworkTypeName() == "muzero_atari" && value_output.numel() == batch_size * getDiscreteValueSize()));
-        assert(!forward_result.contains("reward") || (forward_result.contains("reward") && reward_output.numel() == batch_size * getDiscreteValueSize()));
+        assert(!has_reward || (has_reward && reward_output.numel() == batch_size * getDiscreteValueSize()));
         assert(hidden_state_output.numel() == batch_size * getNumHiddenChannels() * getHiddenChannelHeight() * getHiddenChannelWidth());
 
         const int policy_size = getActionSize();
@@ -161,7 +192,7 @@ private:
                                                                 0.0f,
                                                                 [&start_value](const float& sum, const float& value) { return sum + value * start_value++; });
                 muzero_network_output->value_ = utils::invertValue(muzero_network_output->value_);
-                if (forward_result.contains("reward")) {
+                if (has_reward) {
                     start_value = -getDiscreteValueSize() / 2;
                     muzero_network_output->reward_ = std::accumulate(reward_output.data_ptr<float>() + i * getDiscreteValueSize(),
                                                                      reward_output.data_ptr<float>() + (i + 1) * getDiscreteValueSize(),
@@ -181,10 +212,10 @@ private:
     int initial_input_batch_size_;
     int recurrent_input_batch_size_;
     std::mutex initial_mutex_;
-    std::mutex recurrent_mutex_;
+    std::shared_mutex recurrent_mutex_; // shared by the threads copying samples into the batch buffers, unique for claiming a sample
     std::vector<torch::Tensor> initial_tensor_input_;
-    std::vector<torch::Tensor> recurrent_tensor_feature_input_;
-    std::vector<torch::Tensor> recurrent_tensor_action_input_;
+    torch::Tensor recurrent_feature_input_; // the hidden states, allocated by the first push of each hidden state type
+    torch::Tensor recurrent_action_input_;  // kReserved_batch_size samples at first, doubled whenever full along with recurrent_feature_input_
 
     const int kReserved_batch_size = 4096;
 };
@@ -0,0 +1,92 @@
+#include "cpu_affinity.h"
+#include <algorithm>
+#include <cctype>
+#include <dirent.h>
+#include <fstream>
+#include <sched.h>
+#include <sstream>
+
+namespace minizero::utils {
+
+std::vector<int> parseCPUList(const std::string& cpu_list)
+{
+    std::vector<int> cpus;
+    std::istringstream iss(cpu_list);
+    std::string range;
+    while (std::getline(iss, range, ',')) {
+        range.erase(std::remove_if(range.begin(), range.end(), [](char c) { return std::isspace(static_cast<unsigned char>(c)); }), range.end());
+        if (range.empty()) { continue; }
+        const size_t dash = range.find('-');
+        const int first = std::stoi(range.substr(0, dash));
+        const int last = (dash == std::string::npos ? first : std::stoi(range.substr(dash + 1)));
+        for (int cpu = first; cpu <= last; ++cpu) { cpus.push_back(cpu); }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+std::string toCPUListString(const std::vector<int>& cpus)
+{
+    std::ostringstream oss;
+    for (size_t i = 0; i < cpus.size();) {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) { ++j; }
+        oss << (i == 0 ? "" : ",") << cpus[i];
+        if (j > i) { oss << "-" << cpus[j]; }
+        i = j + 1;
+    }
+    return oss.str();
+}
+
+std::vector<NUMANode> getNUMANodes()
+{
+    const std::vector<int> allowed_cpus = getThreadAffinity(pthread_self());
+    std::vector<NUMANode> numa_nodes;
+    const std::string node_directory = "/sys/devices/system/node";
+    if (DIR* dir = opendir(node_directory.c_str())) {
+        while (dirent* entry = readdir(dir)) {
+            const std::string name = entry->d_name;
+            if (name.size() <= 4 || name.substr(0, 4) != "node" || !std::all_of(name.begin() + 4, name.end(), ::isdigit)) { continue; }
+
+            std::ifstream fin(node_directory + "/" + name + "/cpulist");
+            std::string cpu_list;
+            if (!std::getline(fin, cpu_list)) { continue; }
+            NUMANode numa_node;
+            numa_node.id_ = std::stoi(name.substr(4));
+            for (int cpu : parseCPUList(cpu_list)) {
+                if (std::binary_search(allowed_cpus.begin(), allowed_cpus.end(), cpu)) { numa_node.cpus_.push_back(cpu); }
+            }
+            if (!numa_node.cpus_.empty()) { numa_nodes.push_back(numa_node); }
+        }
+        closedir(dir);
+    }
+    std::sort(numa_nodes.begin(), numa_nodes.end(), [](const NUMANode& lhs, const NUMANode& rhs) { return lhs.id_ < rhs.id_; });
+    if (numa_nodes.empty()) { numa_nodes.push_back({-1, allowed_cpus}); }
+    return numa_nodes;
+}
+
+std::vector<int> getThreadAffinity(pthread_t thread)
+{
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    if (pthread_getaffinity_np(thread, sizeof(cpu_set), &cpu_set) != 0) { return {}; }
+
+    std::vector<int> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &cpu_set)) { cpus.push_back(cpu); }
+    }
+    return cpus;
+}
+
+bool setThreadAffinity(pthread_t thread, const std::vector<int>& cpus)
+{
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) { CPU_SET(cpu, &cpu_set); }
+    }
+    return (CPU_COUNT(&cpu_set) > 0 && pthread_setaffinity_np(thread, sizeof(cpu_set), &cpu_set) == 0);
+}
+
+} // namespace minizero::utils
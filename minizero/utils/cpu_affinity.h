@@ -0,0 +1,26 @@
+#pragma once
+
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+namespace minizero::utils {
+
+class NUMANode {
+public:
+    int id_; // the node ID of the system, -1 if the topology is unknown
+    std::vector<int> cpus_;
+};
+
+// the CPUs of a list such as "0-3,8,10-11", the format of taskset -c and /sys/devices/system/node/node*/cpulist
+std::vector<int> parseCPUList(const std::string& cpu_list);
+std::string toCPUListString(const std::vector<int>& cpus);
+
+// the NUMA nodes with CPUs the process may run on, and only those CPUs; a single node of unknown ID if there is no NUMA information
+std::vector<NUMANode> getNUMANodes();
+
+// empty if failed
+std::vector<int> getThreadAffinity(pthread_t thread);
+bool setThreadAffinity(pthread_t thread, const std::vector<int>& cpus);
+
+} // namespace minizero::utils
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace minizero::utils {
+
+// IEEE 754 binary16 storage type, converted to/from float on every access
+class Half {
+public:
+    Half() : bits_(0) {}
+    Half(float value) : bits_(floatToHalf(value)) {}
+
+    inline operator float() const { return halfToFloat(bits_); }
+    inline uint16_t getBits() const { return bits_; }
+
+    static inline uint16_t floatToHalf(float value)
+    {
+        uint32_t f;
+        std::memcpy(&f, &value, sizeof(f));
+        const uint32_t sign = (f >> 16) & 0x8000;
+        const uint32_t abs = f & 0x7FFFFFFF;
+        if (abs >= 0x7F800000) { return sign | (abs > 0x7F800000 ? 0x7E00 : 0x7C00); } // NaN or Inf
+        if (abs >= 0x477FF000) { return sign | 0x7C00; }                               // overflow after rounding
+        if (abs < 0x38800000) {                                                        // subnormal or zero
+            if (abs < 0x33000000) { return sign; }
+            const uint32_t mantissa = (abs & 0x007FFFFF) | 0x00800000;
+            const int shift = 126 - static_cast<int>(abs >> 23);
+            const uint32_t half_mantissa = mantissa >> shift;
+            const uint32_t remainder = mantissa & ((1u << shift) - 1);
+            const uint32_t halfway = 1u << (shift - 1);
+            return sign | (half_mantissa + ((remainder > halfway || (remainder == halfway && (half_mantissa & 1))) ? 1 : 0));
+        }
+        // normal: rebias exponent and round mantissa to nearest even
+        const uint32_t rounded = abs + 0x00000FFF + ((abs >> 13) & 1);
+        return sign | ((rounded - 0x38000000) >> 13);
+    }
+
+    static inline float halfToFloat(uint16_t half)
+    {
+        const uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+        const uint32_t exponent = (half >> 10) & 0x1F;
+        uint32_t mantissa = half & 0x03FF;
+        uint32_t f;
+        if (exponent == 0x1F) {
+            f = sign | 0x7F800000 | (mantissa << 13);
+        } else if (exponent != 0) {
+            f = sign | ((exponent + 112) << 23) | (mantissa << 13);
+        } else if (mantissa == 0) {
+            f = sign;
+        } else {
+            int e = 113;
+            while ((mantissa & 0x0400) == 0) {
+                mantissa <<= 1;
+                --e;
+            }
+            f = sign | (static_cast<uint32_t>(e) << 23) | ((mantissa & 0x03FF) << 13);
+        }
+        float value;
+        std::memcpy(&value, &f, sizeof(value));
+        return value;
+    }
+
+private:
+    uint16_t bits_;
+};
+
+// bfloat16 storage type, the upper half of a float: the same range with an 8-bit mantissa
+class BFloat16 {
+public:
+    BFloat16() : bits_(0) {}
+    BFloat16(float value) : bits_(floatToBFloat16(value)) {}
+
+    inline operator float() const { return bfloat16ToFloat(bits_); }
+    inline uint16_t getBits() const { return bits_; }
+
+    static inline uint16_t floatToBFloat16(float value)
+    {
+        uint32_t f;
+        std::memcpy(&f, &value, sizeof(f));
+        if ((f & 0x7FFFFFFF) > 0x7F800000) { return (f >> 16) | 0x0040; } // quiet NaN
+        return (f + 0x00007FFF + ((f >> 16) & 1)) >> 16;                   // round to nearest even
+    }
+
+    static inline float bfloat16ToFloat(uint16_t bfloat16)
+    {
+        const uint32_t f = static_cast<uint32_t>(bfloat16) << 16;
+        float value;
+        std::memcpy(&value, &f, sizeof(value));
+        return value;
+    }
+
+private:
+    uint16_t bits_;
+};
+
+} // namespace minizero::utils
@@ -72,7 +72,7 @@ protected:
         createSharedData();
         for (int id = 0; id < num_threads; ++id) {
             slave_threads_.emplace_back(newSlaveThread(id));
-            thread_groups_.create_thread(boost::bind(&BaseSlaveThread::run, slave_threads_.back()));
+            slave_thread_handles_.emplace_back(thread_groups_.create_thread(boost::bind(&BaseSlaveThread::run, slave_threads_.back())));
         }
     }
 
@@ -82,6 +82,7 @@ protected:
     boost::thread_group thread_groups_;
     std::shared_ptr<BaseSharedData> shared_data_;
     std::vector<std::shared_ptr<BaseSlaveThread>> slave_threads_;
+    std::vector<boost::thread*> slave_thread_handles_; // owned by thread_groups_, for the native handles of the slave threads
 };
 
 } // namespace minizero::utils
@@ -0,0 +1,58 @@
+#include "time_profiler.h"
+
+namespace minizero::utils {
+
+bool TimeProfiler::is_enabled_ = false;
+std::mutex TimeProfiler::mutex_;
+std::vector<std::shared_ptr<TimeProfiler::ThreadTimes>> TimeProfiler::thread_times_;
+
+void TimeProfiler::add(Stage stage, std::chrono::steady_clock::duration duration)
+{
+    std::atomic<int64_t>& nanoseconds = getThreadTimes().nanoseconds_[static_cast<int>(stage)];
+    nanoseconds.store(nanoseconds.load(std::memory_order_relaxed) + std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(), std::memory_order_relaxed);
+}
+
+std::array<double, TimeProfiler::kNumStages> TimeProfiler::getSeconds()
+{
+    std::array<double, kNumStages> seconds{};
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& thread_times : thread_times_) {
+        for (int stage = 0; stage < kNumStages; ++stage) { seconds[stage] += thread_times->nanoseconds_[stage].load(std::memory_order_relaxed) * 1e-9; }
+    }
+    return seconds;
+}
+
+void TimeProfiler::reset()
+{
+    // should only be called while the profiled threads are idle
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& thread_times : thread_times_) {
+        for (auto& nanoseconds : thread_times->nanoseconds_) { nanoseconds.store(0, std::memory_order_relaxed); }
+    }
+}
+
+std::string TimeProfiler::getStageName(Stage stage)
+{
+    switch (stage) {
+        case Stage::kSelection: return "selection";
+        case Stage::kFeatureExtraction: return "feature extraction";
+        case Stage::kForward: return "forward";
+        case Stage::kOutputDecoding: return "output decoding";
+        case Stage::kExpansionBackup: return "expansion/backup";
+        case Stage::kGameOutput: return "game output";
+        default: return "unknown";
+    }
+}
+
+TimeProfiler::ThreadTimes& TimeProfiler::getThreadTimes()
+{
+    thread_local std::shared_ptr<ThreadTimes> thread_times = []() {
+        std::shared_ptr<ThreadTimes> times = std::make_shared<ThreadTimes>();
+        std::lock_guard<std::mutex> lock(mutex_);
+        thread_times_.push_back(times);
+        return times;
+    }();
+    return *thread_times;
+}
+
+} // namespace minizero::utils
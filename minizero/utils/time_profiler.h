@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace minizero::utils {
+
+// the time spent by all threads in the stages of self-play, only measured once enabled since reading the clock costs tens of nanoseconds per stage
+class TimeProfiler {
+public:
+    enum class Stage {
+        kSelection,
+        kFeatureExtraction,
+        kForward, // including the transfer of the inputs and outputs between the host and the device
+        kOutputDecoding,
+        kExpansionBackup,
+        kGameOutput,
+        kStageSize
+    };
+    static constexpr int kNumStages = static_cast<int>(Stage::kStageSize);
+
+    static inline void enable() { is_enabled_ = true; }
+    static inline bool isEnabled() { return is_enabled_; }
+    static void add(Stage stage, std::chrono::steady_clock::duration duration);
+    static std::array<double, kNumStages> getSeconds(); // summed over the threads
+    static void reset();
+    static std::string getStageName(Stage stage);
+
+private:
+    class ThreadTimes {
+    public:
+        std::array<std::atomic<int64_t>, kNumStages> nanoseconds_{}; // only written by the owner thread
+    };
+
+    static ThreadTimes& getThreadTimes();
+
+    static bool is_enabled_; // set before the profiled threads start
+    static std::mutex mutex_;
+    static std::vector<std::shared_ptr<ThreadTimes>> thread_times_; // kept after the threads exit
+};
+
+// adds the time of its scope to a stage if the profiler is enabled
+class ScopedStageTimer {
+public:
+    explicit ScopedStageTimer(TimeProfiler::Stage stage)
+        : stage_(stage),
+          is_enabled_(TimeProfiler::isEnabled())
+    {
+        if (is_enabled_) { start_ = std::chrono::steady_clock::now(); }
+    }
+
+    ~ScopedStageTimer()
+    {
+        if (is_enabled_) { TimeProfiler::add(stage_, std::chrono::steady_clock::now() - start_); }
+    }
+
+private:
+    TimeProfiler::Stage stage_;
+    bool is_enabled_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace minizero::utils
@@ -62,6 +62,17 @@ bool ZeroWorkerSharedData::getSelfPlayData(ZeroSelfPlayData& sp_data)
     return true;
 }
 
+bool ZeroWorkerSharedData::getReanalyseData(ZeroSelfPlayData& re_data)
+{
+    if (re_data_queue_.empty()) { return false; }
+
+    boost::lock_guard<boost::mutex> lock(mutex_);
+    if (re_data_queue_.empty()) { return false; }
+    re_data = re_data_queue_.front();
+    re_data_queue_.pop();
+    return true;
+}
+
 bool ZeroWorkerSharedData::isOptimizationPahse()
 {
     boost::lock_guard<boost::mutex> lock(mutex_);
@@ -84,9 +95,9 @@ void ZeroWorkerHandler::handleReceivedMessage(const std::string& message)
         type_ = args[2];
         boost::lock_guard<boost::mutex> lock(shared_data_.worker_mutex_);
         shared_data_.logger_.addWorkerLog("[Worker Connection] " + getName() + " " + getType());
-        if (type_ == "sp") {
+        if (type_ == "sp" || type_ == "re") {
             std::string job_command = "";
-            job_command += "Job_SelfPlay ";
+            job_command += (type_ == "sp" ? "Job_SelfPlay " : "Job_Reanalyse ");
             job_command += config::zero_training_directory + " ";
             job_command += "nn_file_name=" + config::zero_training_directory + "/model/weight_iter_" + std::to_string(shared_data_.getModelIetration()) + ".pt";
             job_command += ":program_auto_seed=false:program_seed=" + std::to_string(utils::Random::randInt());
@@ -121,6 +132,15 @@ void ZeroWorkerHandler::handleReceivedMessage(const std::string& message)
         if (shared_data_.sp_data_queue_.size() % std::max(1, static_cast<int>(config::zero_num_games_per_iteration * 0.25)) == 0) {
             shared_data_.logger_.addTrainingLog("[SelfPlay Game Buffer] " + std::to_string(shared_data_.sp_data_queue_.size()) + " games");
         }
+    } else if (args[0] == "Reanalyse") {
+        if (message.find("Reanalyse", message.find("Reanalyse", 0) + 1) != std::string::npos || message.back() != '#') {
+            shared_data_.logger_.addWorkerLog("[Worker Error] Receive broken reanalysed games");
+            return;
+        }
+
+        ZeroSelfPlayData re_data(message);
+        boost::lock_guard<boost::mutex> lock(shared_data_.mutex_);
+        shared_data_.re_data_queue_.push(re_data);
     } else if (args[0] == "Optimization_Done") {
         boost::lock_guard<boost::mutex> lock(shared_data_.mutex_);
         shared_data_.model_iteration_ = stoi(args[1]);
@@ -183,16 +203,34 @@ void ZeroServer::selfPlay()
 {
     // setup
     std::string self_play_file_name = config::zero_training_directory + "/sgf/" + std::to_string(iteration_) + ".sgf";
+    std::string reanalyse_file_name = config::zero_training_directory + "/sgf/" + std::to_string(iteration_) + "_re.sgf";
     if (config::zero_num_games_per_iteration > 0) { shared_data_.logger_.getSelfPlayFileStream().open(self_play_file_name.c_str(), std::ios::out); }
+    if (config::zero_num_reanalyse_games_per_iteration > 0) { shared_data_.logger_.getReanalyseFileStream().open(reanalyse_file_name.c_str(), std::ios::out); }
     shared_data_.logger_.addTrainingLog("[Iteration] =====" + std::to_string(iteration_) + "=====");
     shared_data_.logger_.addTrainingLog("[SelfPlay] Start " + std::to_string(shared_data_.getModelIetration()));
 
+    // the games reanalysed by the model of a previous iteration are discarded, including those still arriving after its re job stopped
+    const std::string reanalyse_model_tag = "RA[weight_iter_" + std::to_string(shared_data_.getModelIetration()) + ".pt]";
+    {
+        boost::lock_guard<boost::mutex> lock(shared_data_.mutex_);
+        shared_data_.re_data_queue_ = std::queue<ZeroSelfPlayData>();
+    }
+
     std::vector<int> game_lengths;
     std::vector<float> game_returns;
-    int num_collect_game = 0, total_data_length = 0;
+    int num_collect_game = 0, total_data_length = 0, num_reanalyse_game = 0;
     while (num_collect_game < config::zero_num_games_per_iteration) {
         broadcastSelfPlayJob();
 
+        // save reanalysed games alongside the self-play, until enough are collected
+        ZeroSelfPlayData re_data;
+        if (num_reanalyse_game < config::zero_num_reanalyse_games_per_iteration) { broadcastReanalyseJob(); }
+        while (num_reanalyse_game < config::zero_num_reanalyse_games_per_iteration && shared_data_.getReanalyseData(re_data)) {
+            if (re_data.game_record_.find(reanalyse_model_tag) == std::string::npos) { continue; }
+            shared_data_.logger_.getReanalyseFileStream() << re_data.game_record_ << (re_data.is_terminal_ ? " #" : "") << std::endl;
+            if (++num_reanalyse_game == config::zero_num_reanalyse_games_per_iteration) { stopJob("re"); }
+        }
+
         // read one selfplay game
         ZeroSelfPlayData sp_data;
         if (!shared_data_.getSelfPlayData(sp_data)) {
@@ -221,8 +259,11 @@ void ZeroServer::selfPlay()
     }
 
     stopJob("sp");
+    stopJob("re");
     if (config::zero_num_games_per_iteration > 0) { shared_data_.logger_.getSelfPlayFileStream().close(); }
+    if (config::zero_num_reanalyse_games_per_iteration > 0) { shared_data_.logger_.getReanalyseFileStream().close(); }
     shared_data_.logger_.addTrainingLog("[SelfPlay] Finished.");
+    if (config::zero_num_reanalyse_games_per_iteration > 0) { shared_data_.logger_.addTrainingLog("[Reanalyse # Games] " + std::to_string(num_reanalyse_game)); }
     if (!game_lengths.empty()) {
         shared_data_.logger_.addTrainingLog("[SelfPlay # Finished Games] " + std::to_string(game_lengths.size()));
         shared_data_.logger_.addTrainingLog("[SelfPlay Min. Game Lengths] " + std::to_string(*std::min_element(game_lengths.begin(), game_lengths.end())));
@@ -249,6 +290,23 @@ void ZeroServer::broadcastSelfPlayJob()
     }
 }
 
+void ZeroServer::broadcastReanalyseJob()
+{
+    // the games of the previous iterations in the replay buffer
+    const int start_iteration = std::max(1, iteration_ - config::zero_replay_buffer + 1);
+    const int end_iteration = iteration_ - 1;
+    if (end_iteration < start_iteration) { return; }
+
+    boost::lock_guard<boost::mutex> lock(worker_mutex_);
+    for (auto& worker : connections_) {
+        if (!worker->isIdle() || worker->getType() != "re") { continue; }
+        worker->setIdle(false);
+        worker->write("load_model " + config::zero_training_directory + "/model/weight_iter_" + std::to_string(shared_data_.getModelIetration()) + ".pt");
+        worker->write("reanalyse " + std::to_string(start_iteration) + " " + std::to_string(end_iteration));
+        worker->write("start");
+    }
+}
+
 void ZeroServer::optimization()
 {
     shared_data_.logger_.addTrainingLog("[Optimization] Start.");
@@ -301,7 +359,7 @@ void ZeroServer::stopJob(const std::string& job_type)
     boost::lock_guard<boost::mutex> lock(worker_mutex_);
     for (auto worker : connections_) {
         if (worker->getType() != job_type) { continue; }
-        if (job_type == "sp") { worker->write("stop"); }
+        if (job_type == "sp" || job_type == "re") { worker->write("stop"); }
         worker->setIdle(true);
     }
 }
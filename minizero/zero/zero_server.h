@@ -20,6 +20,7 @@ public:
     inline void addWorkerLog(const std::string& log_str) { addLog(log_str, worker_log_); }
     inline void addTrainingLog(const std::string& log_str) { addLog(log_str, training_log_); }
     inline std::fstream& getSelfPlayFileStream() { return self_play_game_; }
+    inline std::fstream& getReanalyseFileStream() { return reanalyse_game_; }
 
 private:
     void addLog(const std::string& log_str, std::fstream& log_file);
@@ -27,6 +28,7 @@ private:
     std::fstream worker_log_;
     std::fstream training_log_;
     std::fstream self_play_game_;
+    std::fstream reanalyse_game_;
 };
 
 class ZeroSelfPlayData {
@@ -49,6 +51,7 @@ public:
     }
 
     bool getSelfPlayData(ZeroSelfPlayData& sp_data);
+    bool getReanalyseData(ZeroSelfPlayData& re_data);
     bool isOptimizationPahse();
     int getModelIetration();
 
@@ -59,6 +62,7 @@ public:
     ZeroLogger logger_;
     std::string updated_conf_str_;
     std::queue<ZeroSelfPlayData> sp_data_queue_;
+    std::queue<ZeroSelfPlayData> re_data_queue_; // the games of previous iterations with the action info searched again by re workers
     boost::mutex mutex_;
     boost::mutex& worker_mutex_;
 };
@@ -106,6 +110,7 @@ protected:
     virtual void initialize();
     virtual void selfPlay();
     virtual void broadcastSelfPlayJob();
+    virtual void broadcastReanalyseJob();
     virtual void optimization();
     virtual std::string getUpdatedConfig();
     void syncConfig();
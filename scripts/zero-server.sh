@@ -86,7 +86,7 @@ if [[ ${run_stage,} == "r" ]]; then
 	if [[ ! -z ${link_sgf} ]];
 	then
 		ln ${link_sgf}/* ${train_dir}/sgf/
-		end_iteration=$(ls ${train_dir}/sgf/ | wc -l)
+		end_iteration=$(ls ${train_dir}/sgf/ | grep -v _re | wc -l)
 		echo "link ${link_sgf} ..."
 		echo "end_iteration: ${end_iteration}"
 	fi
@@ -3,12 +3,12 @@
 usage()
 {
 	echo "Usage: $0 GAME_TYPE HOST PORT WORKER_TYPE [OPTION]..."
-	echo "The zero-worker connects to a zero-server and performs either self-play or optimization."
+	echo "The zero-worker connects to a zero-server and performs self-play, optimization, or reanalyse."
 	echo ""
 	echo "Required arguments:"
 	echo "  GAME_TYPE: $(find ./ ../ -maxdepth 2 -name build.sh -exec grep -m1 support_games {} \; -quit | sed -E 's/.+\("|"\).*//g;s/" "/, /g')"
 	echo "  HOST, PORT: the host and port to connect the zero-server"
-	echo "  WORKER_TYPE: sp, op"
+	echo "  WORKER_TYPE: sp, op, re"
 	echo ""
 	echo "Optional arguments:"
 	echo "  -h,        --help                 Give this help list"
@@ -143,14 +143,15 @@ do
 				if [ "$line" == "keep_alive" ]
 				then
 					true
-				elif [[ $line =~ ^Job_SelfPlay\ (.+) ]]
+				elif [[ $line =~ ^Job_(SelfPlay|Reanalyse)\ (.+) ]]
 				then
-					# format: Self-play train_dir conf_str
-					var=(${BASH_REMATCH[1]})
+					# format: Job_SelfPlay/Job_Reanalyse train_dir conf_str, run by the sp/re mode of the same executable
+					[ "${BASH_REMATCH[1]}" == "SelfPlay" ] && mode=sp || mode=re
+					var=(${BASH_REMATCH[2]})
 					CONF_FILE=$(ls ${var[0]}/*.cfg)
 					CONF_STR="${var[1]}:zero_training_directory=${var[0]}:zero_num_threads=${num_cpu_thread}:zero_num_parallel_games=$((${batch_size}*${num_gpu}))${additional_conf_str}"
-					echo "CUDA_VISIBLE_DEVICES=${cuda_devices} ${sp_executable_file} -mode sp -conf_file ${CONF_FILE} -conf_str \"${CONF_STR}\""
-					CUDA_VISIBLE_DEVICES=${cuda_devices} ${sp_executable_file} -conf_file ${CONF_FILE} -conf_str "${CONF_STR}" -mode sp 0<&$broker_fd 1>&$broker_fd
+					echo "CUDA_VISIBLE_DEVICES=${cuda_devices} ${sp_executable_file} -mode ${mode} -conf_file ${CONF_FILE} -conf_str \"${CONF_STR}\""
+					CUDA_VISIBLE_DEVICES=${cuda_devices} ${sp_executable_file} -conf_file ${CONF_FILE} -conf_str "${CONF_STR}" -mode ${mode} 0<&$broker_fd 1>&$broker_fd
 				elif [[ $line =~ ^Job_Optimization\ (.+) ]]
 				then
 					var=(${BASH_REMATCH[1]})